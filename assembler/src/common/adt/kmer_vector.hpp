@@ -138,6 +138,12 @@ public:
         vector_.set_size(size_);
     }
 
+    void resize(size_t size) {
+        reserve(size);
+        size_ = size;
+        vector_.set_size(size_);
+    }
+
     void shrink_to_fit() {
         capacity_ = std::max(size_, size_t(1));
         vector_.set_data(realloc());
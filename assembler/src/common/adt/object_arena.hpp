@@ -0,0 +1,93 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/parallel/openmp_wrapper.h"
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace adt {
+
+// Slab allocator for objects of the single type. Memory is carved out of
+// geometrically growing slabs and freed objects are recycled via intrusive
+// free lists. Slabs are released only together with the arena.
+//
+// The arena is split into several shards selected by the OpenMP thread number,
+// so threads allocating in parallel (e.g. during graph construction) do not
+// contend for the same lock. Object could be freed from any thread.
+//
+// Note that arena only manages the memory: objects are constructed via
+// placement new and destroyed explicitly by the owner.
+template<class T>
+class ObjectArena {
+    union Cell {
+        Cell *next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    static const size_t MinSlabSize = 64;
+    static const size_t MaxSlabSize = 64 * 1024;
+    static const unsigned ShardCount = 16;
+
+    struct Shard {
+        std::mutex lock;
+        Cell *free = nullptr;
+        Cell *slab_pos = nullptr, *slab_end = nullptr;
+        size_t next_slab_size = MinSlabSize;
+        std::vector<std::unique_ptr<Cell[]>> slabs;
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+
+    ObjectArena(const ObjectArena &) = delete;
+    ObjectArena &operator=(const ObjectArena &) = delete;
+
+    Shard &current_shard() {
+        return shards_[unsigned(omp_get_thread_num()) % ShardCount];
+    }
+
+public:
+    ObjectArena()
+            : shards_(new Shard[ShardCount]) {}
+
+    void *allocate() {
+        Shard &shard = current_shard();
+        std::lock_guard<std::mutex> guard(shard.lock);
+
+        if (Cell *cell = shard.free) {
+            shard.free = cell->next;
+            return &cell->storage;
+        }
+
+        if (shard.slab_pos == shard.slab_end) {
+            size_t sz = shard.next_slab_size;
+            shard.slabs.emplace_back(new Cell[sz]);
+            shard.slab_pos = shard.slabs.back().get();
+            shard.slab_end = shard.slab_pos + sz;
+            shard.next_slab_size = std::min(2 * sz, MaxSlabSize);
+        }
+
+        return &(shard.slab_pos++)->storage;
+    }
+
+    void deallocate(void *ptr) {
+        VERIFY(ptr);
+        Cell *cell = reinterpret_cast<Cell*>(ptr);
+
+        Shard &shard = current_shard();
+        std::lock_guard<std::mutex> guard(shard.lock);
+        cell->next = shard.free;
+        shard.free = cell;
+    }
+};
+
+}
@@ -9,65 +9,245 @@
 #define QUEUE_ITERATOR_HPP_
 
 #include "utils/verify.hpp"
-#include <set>
+#include <algorithm>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 
 namespace adt {
 
 
+namespace impl {
+
+/*
+ * Comparator might provide "size_t bucket(const T&) const" method returning the integer priority class
+ * consistent with the comparator: bucket(a) < bucket(b) should imply comparator(a, b).
+ * Such comparators get a bucket queue, all the other ones get a binary heap.
+ */
+template<typename T, typename Comparator, typename = void>
+struct has_bucket : std::false_type {};
+
+template<typename T, typename Comparator>
+struct has_bucket<T, Comparator,
+        decltype((void) std::declval<const Comparator&>().bucket(std::declval<const T&>()))> : std::true_type {};
+
+//Location of the element in the queue: the heap (bucket) and the index inside it
+struct heap_position {
+    size_t heap;
+    size_t index;
+};
+
+/*
+ * Binary min-heap with respect to the comparator over a flat array. Positions of the elements are kept
+ * in the external map (shared by all the heaps of the queue), so any element can be erased in O(log n)
+ * without calling the comparator on it.
+ */
+template<typename T, typename Comparator>
+class indexed_heap {
+public:
+    typedef std::unordered_map<T, heap_position> Positions;
+
+private:
+    Comparator comparator_;
+    size_t id_;
+    std::vector<T> heap_;
+
+    void place(size_t idx, const T &key, Positions &positions) {
+        heap_[idx] = key;
+        positions[key] = heap_position{id_, idx};
+    }
+
+    void sift_up(size_t idx, Positions &positions) {
+        T key = heap_[idx];
+        while (idx > 0) {
+            size_t parent = (idx - 1) / 2;
+            if (!comparator_(key, heap_[parent]))
+                break;
+            place(idx, heap_[parent], positions);
+            idx = parent;
+        }
+        place(idx, key, positions);
+    }
+
+    void sift_down(size_t idx, Positions &positions) {
+        T key = heap_[idx];
+        while (true) {
+            size_t child = 2 * idx + 1;
+            if (child >= heap_.size())
+                break;
+            if (child + 1 < heap_.size() && comparator_(heap_[child + 1], heap_[child]))
+                ++child;
+            if (!comparator_(heap_[child], key))
+                break;
+            place(idx, heap_[child], positions);
+            idx = child;
+        }
+        place(idx, key, positions);
+    }
+
+public:
+    indexed_heap(const Comparator &comparator, size_t id = 0) : comparator_(comparator), id_(id) {}
+
+    void push(const T &key, Positions &positions) {
+        heap_.push_back(key);
+        sift_up(heap_.size() - 1, positions);
+    }
+
+    //key should be present in this heap
+    void erase(const T &key, Positions &positions) {
+        auto it = positions.find(key);
+        size_t idx = it->second.index;
+        positions.erase(it);
+        if (idx + 1 == heap_.size()) {
+            heap_.pop_back();
+            return;
+        }
+        heap_[idx] = heap_.back();
+        heap_.pop_back();
+        if (idx > 0 && comparator_(heap_[idx], heap_[(idx - 1) / 2]))
+            sift_up(idx, positions);
+        else
+            sift_down(idx, positions);
+    }
+
+    const T& top() const { return heap_.front(); }
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+    void clear() { heap_.clear(); }
+};
+
+/*
+ * Bucket queue: elements of the priority class b are kept in the b-th heap (so the ties are still
+ * resolved by the comparator). Only the classes up to the largest one seen get a heap and classes
+ * exceeding MaxBucket share the last one.
+ */
+template<typename T, typename Comparator>
+class bucket_heap {
+    static const size_t MaxBucket = 1 << 10;
+
+    Comparator comparator_;
+    std::vector<indexed_heap<T, Comparator>> buckets_;
+    //no non-empty buckets before this one
+    size_t first_;
+    size_t size_;
+
+    size_t bucket(const T &key) const {
+        return std::min(size_t(comparator_.bucket(key)), MaxBucket);
+    }
+
+    void skip_empty() {
+        while (first_ < buckets_.size() && buckets_[first_].empty())
+            ++first_;
+    }
+
+public:
+    typedef typename indexed_heap<T, Comparator>::Positions Positions;
+
+    bucket_heap(const Comparator &comparator) : comparator_(comparator), first_(0), size_(0) {}
+
+    void push(const T &key, Positions &positions) {
+        size_t b = bucket(key);
+        while (buckets_.size() <= b)
+            buckets_.emplace_back(comparator_, buckets_.size());
+        buckets_[b].push(key, positions);
+        first_ = size_ ? std::min(first_, b) : b;
+        size_ += 1;
+    }
+
+    void erase(const T &key, Positions &positions) {
+        buckets_[positions.find(key)->second.heap].erase(key, positions);
+        size_ -= 1;
+        skip_empty();
+    }
+
+    const T& top() const { return buckets_[first_].top(); }
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    void clear() {
+        for (auto &b : buckets_)
+            b.clear();
+        first_ = buckets_.size();
+        size_ = 0;
+    }
+};
+
+}
+
+/*
+ * Priority queue with erasure of arbitrary elements and no duplicates (as std::set), elements are
+ * ordered with respect to the comparator. Elements are erased eagerly, so the comparator is only
+ * applied to the elements present in the queue (e.g. to the edges which are not deleted yet).
+ * Requires std::hash for T.
+ */
 template<typename T, typename Comparator>
 class erasable_priority_queue {
 private:
-    std::set<T, Comparator> storage_;
+    typedef typename std::conditional<impl::has_bucket<T, Comparator>::value,
+                                      impl::bucket_heap<T, Comparator>,
+                                      impl::indexed_heap<T, Comparator>>::type Heap;
+
+    Heap heap_;
+    //positions of the elements present in the queue inside their heaps
+    typename impl::indexed_heap<T, Comparator>::Positions positions_;
+
 public:
     /*
      * Be careful! This constructor requires Comparator to have default constructor even if you call it with
      * specified comparator. In this case just create default constructor with VERIFY(false) inside it.
      */
     erasable_priority_queue(const Comparator &comparator = Comparator()) :
-        storage_(comparator) {
+        heap_(comparator) {
     }
 
     template<typename InputIterator>
     erasable_priority_queue(InputIterator begin, InputIterator end,
             const Comparator &comparator = Comparator()) :
-        storage_(begin, end, comparator) {
+        heap_(comparator) {
+        insert(begin, end);
     }
 
     void pop() {
-        VERIFY(!storage_.empty());
-        storage_.erase(storage_.begin());
+        VERIFY(!positions_.empty());
+        T key = heap_.top();
+        heap_.erase(key, positions_);
     }
 
     const T& top() const {
-        VERIFY(!storage_.empty());
-        return *(storage_.begin());
+        VERIFY(!positions_.empty());
+        return heap_.top();
     }
 
     void push(const T &key) {
-        storage_.insert(key);
+        if (!positions_.count(key))
+            heap_.push(key, positions_);
     }
 
     bool erase(const T &key) {
-        bool res = storage_.erase(key) > 0;
-        return res;
+        if (!positions_.count(key))
+            return false;
+        heap_.erase(key, positions_);
+        return true;
     }
 
     void clear() {
-        storage_.clear();
+        positions_.clear();
+        heap_.clear();
     }
 
     bool empty() const {
-        return storage_.empty();
+        return positions_.empty();
     }
 
     size_t size() const {
-        return storage_.size();
+        return positions_.size();
     }
 
     template <class InputIterator>
     void insert ( InputIterator first, InputIterator last ) {
-        storage_.insert(first, last);
+        for (auto it = first; it != last; ++it)
+            push(*it);
     }
 
 };
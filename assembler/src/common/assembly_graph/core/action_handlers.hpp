@@ -17,6 +17,44 @@
 
 namespace omnigraph {
 
+/**
+* GraphEventBatch holds graph events collected inside the batch scope of the graph.
+*/
+template<typename VertexId, typename EdgeId>
+struct GraphEventBatch {
+    struct Glue {
+        EdgeId new_edge, edge1, edge2;
+    };
+
+    struct Split {
+        EdgeId old_edge, new_edge_1, new_edge_2;
+    };
+
+    std::vector<VertexId> added_vertices;
+    std::vector<EdgeId> added_edges;
+    std::vector<VertexId> deleted_vertices;
+    std::vector<EdgeId> deleted_edges;
+    std::vector<std::pair<std::vector<EdgeId>, EdgeId>> merges;
+    std::vector<Glue> glues;
+    std::vector<Split> splits;
+
+    bool empty() const {
+        return added_vertices.empty() && added_edges.empty() &&
+               deleted_vertices.empty() && deleted_edges.empty() &&
+               merges.empty() && glues.empty() && splits.empty();
+    }
+
+    void clear() {
+        added_vertices.clear();
+        added_edges.clear();
+        deleted_vertices.clear();
+        deleted_edges.clear();
+        merges.clear();
+        glues.clear();
+        splits.clear();
+    }
+};
+
 /**
 * ActionHandler is base listening class for graph events. All structures and information storages
 * which are meant to synchronize with graph should use this structure. In order to make handler listen
@@ -109,6 +147,24 @@ public:
     virtual void HandleSplit(EdgeId /*old_edge*/, EdgeId /*new_edge_1*/,
                              EdgeId /*new_edge_2*/) { }
 
+    /**
+     * Handlers supporting bulk updates should return true here and override HandleBatch.
+     */
+    virtual bool IsBatchable() const {
+        return false;
+    }
+
+    /**
+     * Bulk event which replaces all the events happened inside the batch scope of the graph
+     * (see ObservableGraph::BatchScope) for batchable handlers. Events of every kind come in the
+     * order they happened (including the conjugate ones), but the order between the kinds is lost.
+     * Vertices and edges deleted inside the scope are still accessible at this moment.
+     * @param batch events collected inside the scope
+     */
+    virtual void HandleBatch(const GraphEventBatch<VertexId, EdgeId> & /*batch*/) {
+        VERIFY_MSG(false, "Handler " << handler_name_ << " does not support batch updates");
+    }
+
     /**
      * Every thread safe descendant should override this method for correct concurrent graph processing.
      */
@@ -174,6 +230,55 @@ public:
 * HandlerApplier contains one method for each of graph events which define the exact way this event
 * should be triggered.
 */
+/**
+* GraphEventRecorder collects graph events for the batchable handlers.
+*/
+template<typename VertexId, typename EdgeId>
+class GraphEventRecorder : public ActionHandler<VertexId, EdgeId> {
+    GraphEventBatch<VertexId, EdgeId> batch_;
+
+public:
+    GraphEventRecorder()
+            : ActionHandler<VertexId, EdgeId>("GraphEventRecorder") {
+    }
+
+    const GraphEventBatch<VertexId, EdgeId> &batch() const {
+        return batch_;
+    }
+
+    void clear() {
+        batch_.clear();
+    }
+
+    void HandleAdd(VertexId v) override {
+        batch_.added_vertices.push_back(v);
+    }
+
+    void HandleAdd(EdgeId e) override {
+        batch_.added_edges.push_back(e);
+    }
+
+    void HandleDelete(VertexId v) override {
+        batch_.deleted_vertices.push_back(v);
+    }
+
+    void HandleDelete(EdgeId e) override {
+        batch_.deleted_edges.push_back(e);
+    }
+
+    void HandleMerge(const std::vector<EdgeId> &old_edges, EdgeId new_edge) override {
+        batch_.merges.emplace_back(old_edges, new_edge);
+    }
+
+    void HandleGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) override {
+        batch_.glues.push_back({new_edge, edge1, edge2});
+    }
+
+    void HandleSplit(EdgeId old_edge, EdgeId new_edge_1, EdgeId new_edge_2) override {
+        batch_.splits.push_back({old_edge, new_edge_1, new_edge_2});
+    }
+};
+
 template<typename VertexId, typename EdgeId>
 class HandlerApplier {
     typedef ActionHandler<VertexId, EdgeId> Handler;
@@ -64,6 +64,11 @@ public:
         return nucls_;
     }
 
+    void set_nucls(const Sequence &nucls) {
+        VERIFY(nucls == nucls_);
+        nucls_ = nucls;
+    }
+
     void inc_raw_coverage(int value) {
         coverage_.inc_coverage(value);
     }
@@ -11,6 +11,8 @@
 #include "coverage.hpp"
 #include "debruijn_data.hpp"
 
+#include <unordered_map>
+
 namespace debruijn_graph {
 
 using omnigraph::CoverageIndex;
@@ -85,6 +87,43 @@ public:
         return Sequence();
     }
 
+    /**
+     * Edge sequences are packed into shared buffers (see Sequence::Pack), so
+     * removed edges might leave the buffers mostly unused, but still pinned by
+     * the survivors. Method repacks the edges living in such buffers.
+     *
+     * @return number of repacked nucleotides
+     */
+    size_t CompactEdgeSequences(double min_used_fraction = 0.5) {
+        // buffer -> used nucleotides
+        std::unordered_map<const void*, size_t> usage;
+        for (auto it = ConstEdgeBegin(/*canonical only*/true); !it.IsEnd(); ++it)
+            usage[EdgeNucls(*it).buffer_id()] += EdgeNucls(*it).size();
+
+        std::vector<EdgeId> edges;
+        std::vector<Sequence> seqs;
+        for (auto it = ConstEdgeBegin(/*canonical only*/true); !it.IsEnd(); ++it) {
+            const Sequence &nucls = EdgeNucls(*it);
+            if (double(usage[nucls.buffer_id()]) >= min_used_fraction * double(nucls.buffer_capacity()))
+                continue;
+
+            edges.push_back(*it);
+            seqs.push_back(nucls);
+        }
+
+        Sequence::Pack(seqs);
+        size_t repacked = 0;
+        for (size_t i = 0; i < edges.size(); ++i) {
+            EdgeId e = edges[i];
+            this->data(e).set_nucls(seqs[i]);
+            if (conjugate(e) != e)
+                this->data(conjugate(e)).set_nucls(!seqs[i]);
+            repacked += seqs[i].size();
+        }
+
+        return repacked;
+    }
+
 private:
     DECL_LOGGER("DeBruijnGraph")
 };
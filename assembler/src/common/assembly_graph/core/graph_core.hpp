@@ -7,16 +7,16 @@
 #pragma once
 
 #include <vector>
-#include <set>
 #include "utils/verify.hpp"
 #include "utils/logger/logger.hpp"
 #include "order_and_law.hpp"
+#include "id_table.hpp"
 #include "utils/stl_utils.hpp"
 
 #include "adt/small_pod_vector.hpp"
+#include "adt/object_arena.hpp"
 
 #include <boost/iterator/iterator_facade.hpp>
-#include <btree/safe_btree_set.h>
 
 namespace omnigraph {
 
@@ -235,14 +235,21 @@ public:
     typedef typename DataMasterT::EdgeData EdgeData;
     typedef restricted::pure_pointer<PairedEdge<DataMaster>> EdgeId;
     typedef restricted::pure_pointer<PairedVertex<DataMaster>> VertexId;
-    typedef btree::safe_btree_set<VertexId> VertexContainer;
+    typedef IdTable<VertexId> VertexContainer;
     typedef typename VertexContainer::const_iterator VertexIt;
     typedef typename PairedVertex<DataMaster>::edge_const_iterator edge_const_iterator;
 
 private:
    restricted::LocalIdDistributor id_distributor_;
    DataMaster master_;
+   // Vertices and edges are allocated from the arenas and are never deleted directly
+   adt::ObjectArena<PairedVertex<DataMaster>> vertex_arena_;
+   adt::ObjectArena<PairedEdge<DataMaster>> edge_arena_;
    VertexContainer vertices_;
+   // While destruction is deferred deleted vertices and edges are only unlinked from the graph
+   bool defer_destruction_;
+   std::vector<VertexId> deferred_vertices_;
+   std::vector<EdgeId> deferred_edges_;
 
    friend class ConstructionHelper<DataMaster>;
 public:
@@ -254,10 +261,6 @@ public:
        return vertices_.end();
    }
 
-   const std::set<VertexId>& vertices() const {
-       return vertices_;
-   }
-
    size_t size() const {
        return vertices_.size();
    }
@@ -284,21 +287,56 @@ private:
        this->vertices_.erase(conjugate(vertex));
    }
 
-   void DestroyVertex(VertexId vertex) {
-       VertexId conjugate = vertex->conjugate();
-       delete vertex.get();
-       delete conjugate.get();
-   }
-
    bool AdditionalCompressCondition(VertexId v) const {
        return !(EdgeEnd(GetUniqueOutgoingEdge(v)) == conjugate(v) && EdgeStart(GetUniqueIncomingEdge(v)) == conjugate(v));
    }
 
+   template<class T, class Arena>
+   static void Destroy(T *ptr, Arena &arena) {
+       ptr->~T();
+       arena.deallocate(ptr);
+   }
+
 protected:
 
+   void DeferDestruction() {
+       defer_destruction_ = true;
+   }
+
+   void ReleaseDeferred() {
+       defer_destruction_ = false;
+       for (EdgeId edge : deferred_edges_)
+           DestroyEdge(edge);
+       for (VertexId vertex : deferred_vertices_)
+           DestroyVertex(vertex);
+       deferred_edges_.clear();
+       deferred_vertices_.clear();
+   }
+
+   void DestroyVertex(VertexId vertex) {
+       if (defer_destruction_) {
+           deferred_vertices_.push_back(vertex);
+           return;
+       }
+       VertexId conjugate = vertex->conjugate();
+       Destroy(vertex.get(), vertex_arena_);
+       Destroy(conjugate.get(), vertex_arena_);
+   }
+
+   void DestroyEdge(EdgeId edge) {
+       if (defer_destruction_) {
+           deferred_edges_.push_back(edge);
+           return;
+       }
+       EdgeId conjugate = edge->conjugate();
+       if (edge != conjugate)
+           Destroy(conjugate.get(), edge_arena_);
+       Destroy(edge.get(), edge_arena_);
+   }
+
    VertexId CreateVertex(const VertexData& data1, const VertexData& data2, restricted::IdDistributor& id_distributor) {
-       VertexId vertex1(new PairedVertex<DataMaster>(data1), id_distributor);
-       VertexId vertex2(new PairedVertex<DataMaster>(data2), id_distributor);
+       VertexId vertex1(new (vertex_arena_.allocate()) PairedVertex<DataMaster>(data1), id_distributor);
+       VertexId vertex2(new (vertex_arena_.allocate()) PairedVertex<DataMaster>(data2), id_distributor);
        vertex1->set_conjugate(vertex2);
        vertex2->set_conjugate(vertex1);
        return vertex1;
@@ -337,7 +375,7 @@ protected:
     ////what with this method?
     EdgeId AddSingleEdge(VertexId v1, VertexId v2, const EdgeData &data,
                          restricted::IdDistributor &idDistributor) {
-        EdgeId newEdge(new PairedEdge<DataMaster>(v2, data), idDistributor);
+        EdgeId newEdge(new (edge_arena_.allocate()) PairedEdge<DataMaster>(v2, data), idDistributor);
         if (v1 != VertexId())
             v1->AddOutgoingEdge(newEdge);
         return newEdge;
@@ -388,10 +426,7 @@ protected:
         VertexId start = conjugate(rcEdge->end());
         start->RemoveOutgoingEdge(edge);
         rcStart->RemoveOutgoingEdge(rcEdge);
-        if (edge != rcEdge) {
-            delete rcEdge.get();
-        }
-        delete edge.get();
+        DestroyEdge(edge);
     }
 
     void HiddenDeletePath(const std::vector<EdgeId>& edgesToDelete, const std::vector<VertexId>& verticesToDelete) {
@@ -403,7 +438,7 @@ protected:
 
 public:
 
-    GraphCore(const DataMaster& master) : master_(master) {
+    GraphCore(const DataMaster& master) : master_(master), defer_destruction_(false) {
     }
 
     virtual ~GraphCore() {
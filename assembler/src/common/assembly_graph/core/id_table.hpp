@@ -0,0 +1,163 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/verify.hpp"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace omnigraph {
+
+// Set of graph element ids (pure pointers) stored in slots indexed by int id.
+// Slots are grouped into fixed-size pages allocated on demand and released
+// once they become empty, so the memory is proportional to the number of
+// elements rather than to the maximal id. Iteration is a linear scan over the
+// pages in the increasing order of ids (the same order std::set provides) and
+// is stable with respect to insertions and deletions of other elements.
+template<class Id>
+class IdTable {
+    static const unsigned PageBits = 10;
+    static const size_t PageSize = size_t(1) << PageBits;
+    static const size_t PageMask = PageSize - 1;
+
+    struct Page {
+        std::array<Id, PageSize> slots;
+        size_t count = 0;
+    };
+
+    std::vector<std::unique_ptr<Page>> pages_;
+    size_t size_;
+    // Lower bound for the smallest occupied slot, makes repeated begin() calls
+    // amortized constant while the table is being cleared from the front.
+    mutable std::atomic<size_t> first_;
+
+public:
+    typedef Id value_type;
+    static const size_t npos = size_t(-1);
+
+    class const_iterator : public boost::iterator_facade<const_iterator,
+            Id, boost::forward_traversal_tag, Id> {
+        friend class boost::iterator_core_access;
+
+        const IdTable *table_;
+        size_t idx_;
+
+        void increment() {
+            idx_ = table_->next(idx_ + 1);
+        }
+
+        bool equal(const const_iterator &other) const {
+            return idx_ == other.idx_;
+        }
+
+        Id dereference() const {
+            return table_->at(idx_);
+        }
+
+    public:
+        const_iterator()
+                : table_(nullptr), idx_(npos) {}
+
+        const_iterator(const IdTable *table, size_t idx)
+                : table_(table), idx_(idx) {}
+    };
+
+    typedef const_iterator iterator;
+
+    IdTable()
+            : size_(0), first_(0) {}
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const_iterator begin() const {
+        size_t first = next(first_.load(std::memory_order_relaxed));
+        first_.store(first, std::memory_order_relaxed);
+        return const_iterator(this, first);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, npos);
+    }
+
+    // Returns the element stored at slot idx or empty id
+    Id at(size_t idx) const {
+        size_t page = idx >> PageBits;
+        if (page >= pages_.size() || !pages_[page])
+            return Id();
+
+        return pages_[page]->slots[idx & PageMask];
+    }
+
+    bool contains(Id id) const {
+        return at(id.int_id()).get() != nullptr;
+    }
+
+    // Index of the first occupied slot starting from idx, npos if there is none
+    size_t next(size_t idx) const {
+        for (size_t page = idx >> PageBits; page < pages_.size(); ++page) {
+            const Page *p = pages_[page].get();
+            if (!p) {
+                idx = (page + 1) << PageBits;
+                continue;
+            }
+
+            for (size_t i = idx & PageMask; i < PageSize; ++i) {
+                if (p->slots[i].get() != nullptr)
+                    return (page << PageBits) | i;
+            }
+            idx = (page + 1) << PageBits;
+        }
+
+        return npos;
+    }
+
+    void insert(Id id) {
+        VERIFY(id.get() != nullptr);
+        size_t idx = id.int_id();
+        size_t page = idx >> PageBits;
+        if (page >= pages_.size())
+            pages_.resize(page + 1);
+        if (!pages_[page])
+            pages_[page].reset(new Page());
+
+        Id &slot = pages_[page]->slots[idx & PageMask];
+        if (slot.get() != nullptr) {
+            VERIFY(slot == id);
+            return;
+        }
+
+        slot = id;
+        pages_[page]->count += 1;
+        size_ += 1;
+        if (idx < first_.load(std::memory_order_relaxed))
+            first_.store(idx, std::memory_order_relaxed);
+    }
+
+    void erase(Id id) {
+        size_t idx = id.int_id();
+        size_t page = idx >> PageBits;
+        if (page >= pages_.size() || !pages_[page])
+            return;
+
+        Id &slot = pages_[page]->slots[idx & PageMask];
+        if (slot.get() == nullptr)
+            return;
+
+        slot = Id();
+        size_ -= 1;
+        if (--pages_[page]->count == 0)
+            pages_[page].reset();
+    }
+};
+
+}
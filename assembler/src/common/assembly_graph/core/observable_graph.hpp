@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <cstring>
@@ -41,6 +42,25 @@ private:
    mutable std::vector<Handler*> action_handler_list_;
    const HandlerApplier<VertexId, EdgeId> *applier_;
 
+   //batch mode state
+   size_t batch_depth_;
+   mutable std::vector<Handler*> batched_handlers_;
+   mutable GraphEventRecorder<VertexId, EdgeId> recorder_;
+
+   //batchable handlers get the events at the end of the batch scope
+   bool Deferred(const Handler* handler) const {
+       return batch_depth_ > 0 &&
+              std::find(batched_handlers_.begin(), batched_handlers_.end(), handler) != batched_handlers_.end();
+   }
+
+   bool Notify(const Handler* handler) const {
+       return handler->IsAttached() && !Deferred(handler);
+   }
+
+   bool Record() const {
+       return !batched_handlers_.empty();
+   }
+
 public:
 //todo move to graph core
     typedef ConstructionHelper<DataMaster> HelperT;
@@ -81,6 +101,33 @@ public:
 
     bool VerifyAllDetached();
 
+    /**
+     * Opens batch scope (scopes might be nested). Inside the scope events for batchable handlers
+     * (see ActionHandler::IsBatchable) are collected and passed to them at once when the outermost
+     * scope is closed, the other handlers are notified as usual. Deleted vertices and edges are
+     * destroyed only when the scope is closed, so the handlers can still access them.
+     * Batchable handlers should not be queried inside the scope since they are not up to date.
+     */
+    void BeginBatch();
+
+    void EndBatch();
+
+    class BatchScope {
+        ObservableGraph &g_;
+    public:
+        BatchScope(ObservableGraph &g) : g_(g) {
+            g_.BeginBatch();
+        }
+
+        ~BatchScope() {
+            g_.EndBatch();
+        }
+
+    private:
+        BatchScope(const BatchScope &) = delete;
+        BatchScope &operator=(const BatchScope &) = delete;
+    };
+
     //smart iterators
     template<typename Comparator>
     SmartVertexIterator<ObservableGraph, Comparator> SmartVertexBegin(
@@ -110,7 +157,7 @@ public:
     void FireDeletePath(const std::vector<EdgeId>& edges_to_delete, const std::vector<VertexId>& vertices_to_delete) const;
 
     ObservableGraph(const DataMaster& master) :
-            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)) {
+            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)), batch_depth_(0) {
     }
 
     virtual ~ObservableGraph();
@@ -290,6 +337,8 @@ bool ObservableGraph<DataMaster>::RemoveActionHandler(const Handler* action_hand
         auto it = std::find(action_handler_list_.begin(), action_handler_list_.end(), action_handler);
         if (it != action_handler_list_.end()) {
             action_handler_list_.erase(it);
+            batched_handlers_.erase(std::remove(batched_handlers_.begin(), batched_handlers_.end(), action_handler),
+                                    batched_handlers_.end());
             TRACE("Action handler " << action_handler->name() << " removed");
             result = true;
         } else {
@@ -319,66 +368,110 @@ void ObservableGraph<DataMaster>::PrintHandlersNames() const {
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddVertex(VertexId v) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (Notify(handler_ptr)) {
             TRACE("FireAddVertex to handler " << handler_ptr->name());
             applier_->ApplyAdd(*handler_ptr, v);
         }
     }
+    if (Record())
+        applier_->ApplyAdd(recorder_, v);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddEdge(EdgeId e) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (Notify(handler_ptr)) {
             TRACE("FireAddEdge to handler " << handler_ptr->name());
             applier_->ApplyAdd(*handler_ptr, e);
         }
     }
+    if (Record())
+        applier_->ApplyAdd(recorder_, e);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteVertex(VertexId v) const {
     for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
-        if ((*it)->IsAttached()) {
+        if (Notify(*it)) {
             applier_->ApplyDelete(**it, v);
         }
     }
+    if (Record())
+        applier_->ApplyDelete(recorder_, v);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteEdge(EdgeId e) const {
     for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
-        if ((*it)->IsAttached()) {
+        if (Notify(*it)) {
             applier_->ApplyDelete(**it, e);
         }
-    };
+    }
+    if (Record())
+        applier_->ApplyDelete(recorder_, e);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireMerge(vector<EdgeId> old_edges, EdgeId new_edge) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (Notify(handler_ptr)) {
             applier_->ApplyMerge(*handler_ptr, old_edges, new_edge);
         }
     }
+    if (Record())
+        applier_->ApplyMerge(recorder_, old_edges, new_edge);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (Notify(handler_ptr)) {
             applier_->ApplyGlue(*handler_ptr, new_edge, edge1, edge2);
         }
-    };
+    }
+    if (Record())
+        applier_->ApplyGlue(recorder_, new_edge, edge1, edge2);
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireSplit(EdgeId edge, EdgeId new_edge1, EdgeId new_edge2) const {
     for (Handler* handler_ptr : action_handler_list_) {
-        if (handler_ptr->IsAttached()) {
+        if (Notify(handler_ptr)) {
             applier_->ApplySplit(*handler_ptr, edge, new_edge1, new_edge2);
         }
     }
+    if (Record())
+        applier_->ApplySplit(recorder_, edge, new_edge1, new_edge2);
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::BeginBatch() {
+    if (batch_depth_++ > 0)
+        return;
+    for (Handler* handler_ptr : action_handler_list_) {
+        if (handler_ptr->IsAttached() && handler_ptr->IsBatchable())
+            batched_handlers_.push_back(handler_ptr);
+    }
+    base::DeferDestruction();
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::EndBatch() {
+    VERIFY(batch_depth_ > 0);
+    if (--batch_depth_ > 0)
+        return;
+    std::vector<Handler*> handlers;
+    std::swap(handlers, batched_handlers_);
+    if (!recorder_.batch().empty()) {
+        for (Handler* handler_ptr : handlers) {
+            if (handler_ptr->IsAttached()) {
+                TRACE("FireBatch to handler " << handler_ptr->name());
+                handler_ptr->HandleBatch(recorder_.batch());
+            }
+        }
+    }
+    recorder_.clear();
+    base::ReleaseDeferred();
 }
 
 template<class DataMaster>
@@ -8,7 +8,9 @@
 
 #include "utils/stl_utils.hpp"
 #include "dijkstra_settings.hpp"
+#include "dijkstra_workspace.hpp"
 
+#include <algorithm>
 #include <queue>
 #include <vector>
 #include <set>
@@ -54,10 +56,11 @@ class Dijkstra {
     typedef typename Graph::EdgeId EdgeId;
     typedef distance_t DistanceType;
 
-    typedef std::map<VertexId, distance_t> distances_map;
-    typedef typename distances_map::const_iterator distances_map_ci;
-    typedef typename std::priority_queue<element_t<Graph, distance_t>, std::vector<element_t<Graph, distance_t>>,
-            ReverseDistanceComparator<element_t<Graph, distance_t>>> queue_t;
+    typedef element_t<Graph, distance_t> element;
+    typedef DijkstraWorkspace<VertexId, EdgeId, distance_t,
+                              element, ReverseDistanceComparator<element>> workspace_t;
+    typedef typename workspace_t::VertexInfo vertex_info;
+    typedef typename workspace_t::Queue queue_t;
 
     // constructor parameters
     const Graph& graph_;
@@ -69,20 +72,18 @@ class Dijkstra {
     size_t vertex_number_;
     bool vertex_limit_exceeded_;
 
-    // accumulative structures
-    distances_map distances_;
-    std::set<VertexId> processed_vertices_;
-    std::map<VertexId, pair<VertexId, EdgeId>> prev_vert_map_;
+    // accumulative structures (distances, processed vertices, predecessors), reused between runs
+    typename WorkspacePool<workspace_t>::Handle workspace_;
 
     void Init(VertexId start, queue_t &queue) {
         vertex_number_ = 0;
-        distances_.clear();
-        processed_vertices_.clear();
-        prev_vert_map_.clear();
+        workspace_->Reset();
         set_finished(false);
         settings_.Init(start);
-        queue.push(element_t<Graph, distance_t>(0, start, VertexId(), EdgeId()));
-        prev_vert_map_[start] = std::pair<VertexId, EdgeId>(VertexId(), EdgeId());
+        queue.push(element(0, start, VertexId(), EdgeId()));
+        vertex_info &info = workspace_->Get(start);
+        info.prev_vertex = VertexId();
+        info.prev_edge = EdgeId();
     }
 
     void set_finished(bool state) {
@@ -117,7 +118,7 @@ class Dijkstra {
                 TRACE("Entry: vertex " << graph_.str(cur_vertex) << " distance " << new_dist);
                 if (CheckPutVertex(cur_pair.vertex, cur_pair.edge, new_dist)) {
                     TRACE("CheckPutVertex returned true and new entry is added");
-                    queue.push(element_t<Graph, distance_t>(new_dist, cur_pair.vertex,
+                    queue.push(element(new_dist, cur_pair.vertex,
                                     cur_vertex, cur_pair.edge));
                 }
             }
@@ -126,6 +127,17 @@ class Dijkstra {
         TRACE("All neighbours of vertex " << graph_.str(cur_vertex) << " processed");
     }
 
+    template<class Predicate>
+    std::vector<VertexId> CollectVertices(Predicate pred) const {
+        std::vector<VertexId> result;
+        for (const vertex_info &info : workspace_->vertices()) {
+            if (pred(info))
+                result.push_back(info.vertex);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
 public:
     Dijkstra(const Graph &graph, DijkstraSettings settings, size_t max_vertex_number = size_t(-1)) :
         graph_(graph),
@@ -133,7 +145,10 @@ public:
         max_vertex_number_(max_vertex_number),
         finished_(false),
         vertex_number_(0),
-        vertex_limit_exceeded_(false) {}
+        vertex_limit_exceeded_(false),
+        workspace_(WorkspacePool<workspace_t>::Acquire()) {
+        workspace_->Reset();
+    }
 
     Dijkstra(Dijkstra&& /*other*/) = default; 
 
@@ -148,41 +163,39 @@ public:
     }
 
     bool DistanceCounted(VertexId vertex) const {
-        return distances_.find(vertex) != distances_.end();
+        const vertex_info *info = workspace_->Find(vertex);
+        return info && info->counted;
     }
 
     distance_t GetDistance(VertexId vertex) const {
         VERIFY(DistanceCounted(vertex));
-        return distances_.find(vertex)->second;
-    }
-
-    std::pair<distances_map_ci, distances_map_ci> GetDistances() const {
-        distances_map_ci begin = distances_.begin();
-        distances_map_ci end = distances_.end();
-        return make_pair(begin, end);
+        return workspace_->Find(vertex)->distance;
     }
 
     void Run(VertexId start) {
         TRACE("Starting dijkstra run from vertex " << graph_.str(start));
-        queue_t queue;
+        queue_t &queue = workspace_->queue();
         Init(start, queue);
         TRACE("Priority queue initialized. Starting search");
 
         while (!queue.empty() && !finished()) {
             TRACE("Dijkstra iteration started");
-            const element_t<Graph, distance_t>& next = queue.top();
+            const element& next = queue.top();
             distance_t distance = next.distance;
             VertexId vertex = next.curr_vertex;
 
-            prev_vert_map_[vertex] = std::pair<VertexId, EdgeId>(next.prev_vertex, next.edge_between);
+            vertex_info &info = workspace_->Get(vertex);
+            info.prev_vertex = next.prev_vertex;
+            info.prev_edge = next.edge_between;
             queue.pop();
             TRACE("Vertex " << graph_.str(vertex) << " with distance " << distance << " fetched from queue");
 
-            if (DistanceCounted(vertex)) {
+            if (info.counted) {
                 TRACE("Distance to vertex " << graph_.str(vertex) << " already counted. Proceeding to next queue entry.");
                 continue;
             }
-            distances_.insert(make_pair(vertex, distance));
+            info.counted = true;
+            info.distance = distance;
 
             TRACE("Vertex " << graph_.str(vertex) << " is found to be at distance "
                     << distance << " from vertex " << graph_.str(start));
@@ -190,7 +203,7 @@ public:
                 TRACE("Check for processing vertex failed. Proceeding to the next queue entry.");
                 continue;
             }
-            processed_vertices_.insert(vertex);
+            info.processed = true;
             AddNeighboursToQueue(vertex, distance, queue);
         }
         set_finished(true);
@@ -199,36 +212,34 @@ public:
 
     std::vector<EdgeId> GetShortestPathTo(VertexId vertex) {
         std::vector<EdgeId> path;
-        if (prev_vert_map_.find(vertex) == prev_vert_map_.end())
+        const vertex_info *info = workspace_->Find(vertex);
+        if (!info)
             return path;
 
-        VertexId curr_vertex = vertex;
-        VertexId prev_vertex = utils::get(prev_vert_map_, vertex).first;
-        EdgeId edge = utils::get(prev_vert_map_, curr_vertex).second;
+        VertexId prev_vertex = info->prev_vertex;
+        EdgeId edge = info->prev_edge;
 
         while (prev_vertex != VertexId()) {
             if (graph_.EdgeStart(edge) == prev_vertex)
                 path.insert(path.begin(), edge);
             else
                 path.push_back(edge);
-            curr_vertex = prev_vertex;
-            const auto& prev_v_e = utils::get(prev_vert_map_, curr_vertex);
-            prev_vertex = prev_v_e.first;
-            edge = prev_v_e.second;
+            info = workspace_->Find(prev_vertex);
+            VERIFY(info);
+            prev_vertex = info->prev_vertex;
+            edge = info->prev_edge;
         }
         return path;
     }
 
+    //Sorted
     vector<VertexId> ReachedVertices() const {
-        vector<VertexId> result;
-        for (auto it = distances_.begin(); it != distances_.end(); ++it) {
-            result.push_back(it->first);
-        }
-        return result;
+        return CollectVertices([](const vertex_info &info) { return info.counted; });
     }
 
-    const set<VertexId>& ProcessedVertices() const {
-        return processed_vertices_;
+    //Sorted
+    vector<VertexId> ProcessedVertices() const {
+        return CollectVertices([](const vertex_info &info) { return info.processed; });
     }
 
     bool VertexLimitExceeded() const {
@@ -0,0 +1,215 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace omnigraph {
+
+/**
+ * @brief 4-ary heap with the std::priority_queue interface and semantics
+ *        (top() is the greatest element w.r.t. Compare). Storage is kept between clear() calls.
+ */
+template<typename T, class Compare>
+class FourAryHeap {
+    static const size_t Arity = 4;
+
+    std::vector<T> data_;
+    Compare comp_;
+
+    void SiftUp(size_t idx) {
+        T item = data_[idx];
+        while (idx > 0) {
+            size_t parent = (idx - 1) / Arity;
+            if (!comp_(data_[parent], item))
+                break;
+            data_[idx] = data_[parent];
+            idx = parent;
+        }
+        data_[idx] = item;
+    }
+
+    void SiftDown(size_t idx) {
+        T item = data_[idx];
+        size_t size = data_.size();
+        while (true) {
+            size_t first = idx * Arity + 1;
+            if (first >= size)
+                break;
+            size_t best = first;
+            for (size_t child = first + 1; child < std::min(first + Arity, size); ++child) {
+                if (comp_(data_[best], data_[child]))
+                    best = child;
+            }
+            if (!comp_(item, data_[best]))
+                break;
+            data_[idx] = data_[best];
+            idx = best;
+        }
+        data_[idx] = item;
+    }
+
+public:
+    bool empty() const {
+        return data_.empty();
+    }
+
+    size_t size() const {
+        return data_.size();
+    }
+
+    const T &top() const {
+        return data_.front();
+    }
+
+    void push(const T &item) {
+        data_.push_back(item);
+        SiftUp(data_.size() - 1);
+    }
+
+    void pop() {
+        data_.front() = data_.back();
+        data_.pop_back();
+        if (!data_.empty())
+            SiftDown(0);
+    }
+
+    void clear() {
+        data_.clear();
+    }
+};
+
+/**
+ * @brief Per-search state of Dijkstra: vertex info is kept in the dense array of the touched
+ *        vertices, which is addressed through the vertex-id indexed array of positions.
+ *        The position is valid only if it points to the entry of the same vertex
+ *        ("sparse set"), so the reset between searches is O(1) and nothing is reallocated
+ *        once the arrays have grown.
+ */
+template<class VertexId, class EdgeId, typename distance_t, class QueueElement, class Compare>
+class DijkstraWorkspace {
+public:
+    struct VertexInfo {
+        VertexId vertex;
+        distance_t distance;
+        VertexId prev_vertex;
+        EdgeId prev_edge;
+        bool counted;
+        bool processed;
+
+        VertexInfo(VertexId v)
+                : vertex(v), distance(0), counted(false), processed(false) {}
+    };
+
+    typedef FourAryHeap<QueueElement, Compare> Queue;
+
+private:
+    std::vector<uint32_t> positions_;
+    std::vector<VertexInfo> vertices_;
+    Queue queue_;
+
+public:
+    void Reset() {
+        vertices_.clear();
+        queue_.clear();
+    }
+
+    Queue &queue() {
+        return queue_;
+    }
+
+    const VertexInfo *Find(VertexId v) const {
+        size_t id = v.int_id();
+        if (id >= positions_.size())
+            return nullptr;
+        size_t pos = positions_[id];
+        if (pos >= vertices_.size() || vertices_[pos].vertex.int_id() != id)
+            return nullptr;
+        return &vertices_[pos];
+    }
+
+    VertexInfo &Get(VertexId v) {
+        if (const VertexInfo *info = Find(v))
+            return const_cast<VertexInfo&>(*info);
+
+        size_t id = v.int_id();
+        if (id >= positions_.size())
+            positions_.resize(std::max(id + 1, 2 * positions_.size()), 0);
+        VERIFY(vertices_.size() < std::numeric_limits<uint32_t>::max());
+        positions_[id] = (uint32_t) vertices_.size();
+        vertices_.emplace_back(v);
+        return vertices_.back();
+    }
+
+    //Vertices touched during the search, in order of appearance
+    const std::vector<VertexInfo> &vertices() const {
+        return vertices_;
+    }
+};
+
+/**
+ * @brief Per-thread pools of the reusable workspaces. Workspace is taken from the pool
+ *        of the current thread and returned to the pool of the thread releasing it.
+ */
+template<class Workspace>
+class WorkspacePool {
+    static const size_t MaxPooled = 16;
+
+    struct FreeList {
+        std::vector<Workspace*> items;
+
+        ~FreeList() {
+            for (Workspace *w : items)
+                delete w;
+            destroyed() = true;
+        }
+    };
+
+    //Set once the pool of the thread is gone (e.g. during the thread exit)
+    static bool &destroyed() {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+
+    static FreeList &free_list() {
+        static thread_local FreeList list;
+        return list;
+    }
+
+    static void Release(Workspace *w) {
+        if (!destroyed() && free_list().items.size() < MaxPooled) {
+            free_list().items.push_back(w);
+        } else {
+            delete w;
+        }
+    }
+
+public:
+    struct Releaser {
+        void operator()(Workspace *w) const {
+            Release(w);
+        }
+    };
+
+    typedef std::unique_ptr<Workspace, Releaser> Handle;
+
+    static Handle Acquire() {
+        if (destroyed() || free_list().items.empty())
+            return Handle(new Workspace());
+        Workspace *w = free_list().items.back();
+        free_list().items.pop_back();
+        return Handle(w);
+    }
+};
+
+}
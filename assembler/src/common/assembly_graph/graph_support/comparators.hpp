@@ -58,5 +58,12 @@ public:
             }
             return graph_.length(edge1) < graph_.length(edge2);
         }
+
+        /**
+         * Priority class of the edge, allows SmartSetIterator to use the bucket queue.
+         */
+        size_t bucket(EdgeId edge) const {
+            return graph_.length(edge);
+        }
     };
 }
\ No newline at end of file
@@ -11,6 +11,10 @@
 #include "assembly_graph/core/graph_iterators.hpp"
 #include "assembly_graph/graph_support/graph_processing_algorithm.hpp"
 #include "utils/parallel/openmp_wrapper.h"
+#include "utils/perf/stage_profiler.hpp"
+
+#include <algorithm>
+#include <unordered_set>
 
 namespace omnigraph {
 
@@ -183,6 +187,7 @@ public:
         size_t total_triggered = 0;
         for (size_t i = 0; i < iteration_cnt; ++i) {
             DEBUG("Iteration " << i);
+            utils::ProfiledScope profile("Cycle " + std::to_string(i + 1));
             size_t algo_triggered = algo.Run(all_primary || (i == 0 && first_primary),
                                 double(i + 1) / double(iteration_cnt));
             DEBUG("Triggered " << algo_triggered << " times on iteration " << (i + 1));
@@ -321,8 +326,114 @@ protected:
     CandidateFinderPtr interest_el_finder_;
 
 private:
+    typedef typename Graph::VertexId VertexId;
+    typedef typename Graph::EdgeId EdgeId;
+
     SmartSetIterator<Graph, ElementId, Comparator> it_;
+    const Comparator comp_;
     const bool tracking_;
+    size_t parallel_batch_;
+
+    //Vertices which might be affected by processing of the element (including conjugate ones).
+    //Processing might compress the vertices of the element, so the adjacent vertices are included
+    //since the edges incident to them might be merged.
+    void CollectNeighbourhood(EdgeId e, std::vector<VertexId> &vertices) const {
+        const Graph &g = this->g();
+        CollectNeighbourhood(g.EdgeStart(e), vertices);
+        CollectNeighbourhood(g.EdgeEnd(e), vertices);
+    }
+
+    void CollectNeighbourhood(VertexId v, std::vector<VertexId> &vertices) const {
+        const Graph &g = this->g();
+        for (VertexId vertex : {v, g.conjugate(v)}) {
+            vertices.push_back(vertex);
+            for (EdgeId e : g.IncidentEdges(vertex)) {
+                vertices.push_back(g.EdgeStart(e));
+                vertices.push_back(g.EdgeEnd(e));
+            }
+        }
+    }
+
+    size_t ProcessSequentially() {
+        size_t triggered = 0;
+        for (; !it_.IsEnd(); ++it_) {
+            ElementId el = *it_;
+            if (!Proceed(el)) {
+                TRACE("Proceed condition turned false on element " << this->g().str(el));
+                it_.ReleaseCurrent();
+                break;
+            }
+            TRACE("Processing edge " << this->g().str(el));
+            if (Process(el))
+                triggered++;
+        }
+        return triggered;
+    }
+
+    //Takes up to parallel_batch_ elements with pairwise disjoint neighbourhoods in the processing order.
+    //Elements interacting with the already taken ones are returned to the queue.
+    //Returns false if the proceed condition turned false.
+    bool FillBatch(std::vector<ElementId> &batch) {
+        std::unordered_set<VertexId> involved;
+        std::vector<ElementId> interacting;
+        std::vector<VertexId> neighbourhood;
+        bool proceed = true;
+        for (size_t considered = 0; !it_.IsEnd() && considered < parallel_batch_; ++it_, ++considered) {
+            ElementId el = *it_;
+            if (!Proceed(el)) {
+                TRACE("Proceed condition turned false on element " << this->g().str(el));
+                it_.ReleaseCurrent();
+                proceed = false;
+                break;
+            }
+            neighbourhood.clear();
+            CollectNeighbourhood(el, neighbourhood);
+            if (std::any_of(neighbourhood.begin(), neighbourhood.end(),
+                            [&](VertexId v) { return involved.count(v); })) {
+                interacting.push_back(el);
+                continue;
+            }
+            involved.insert(neighbourhood.begin(), neighbourhood.end());
+            batch.push_back(el);
+        }
+
+        for (ElementId el : interacting)
+            it_.push(el);
+        return proceed;
+    }
+
+    //Checks are performed in parallel, while the graph is modified sequentially
+    //in the processing order, so the result does not depend on the number of threads.
+    //Elements of the batch do not interact, so the checks stay valid while the batch is processed.
+    size_t ProcessInParallel() {
+        size_t triggered = 0;
+        std::vector<ElementId> batch;
+        bool proceed = true;
+        while (proceed && !it_.IsEnd()) {
+            batch.clear();
+            proceed = FillBatch(batch);
+            TRACE("Checking batch of " << batch.size() << " elements");
+
+            std::vector<char> passed(batch.size());
+            #pragma omp parallel for schedule(guided)
+            for (size_t i = 0; i < batch.size(); ++i)
+                passed[i] = Check(batch[i]);
+
+            //Elements removed while processing the preceding ones are dropped from the set
+            SmartSetIterator<Graph, ElementId, Comparator> to_process(this->g(), false, comp_);
+            for (size_t i = 0; i < batch.size(); ++i)
+                if (passed[i])
+                    to_process.push(batch[i]);
+
+            for (; !to_process.IsEnd(); ++to_process) {
+                ElementId el = *to_process;
+                TRACE("Processing checked element " << this->g().str(el));
+                if (ProcessChecked(el))
+                    triggered++;
+            }
+        }
+        return triggered;
+    }
 
 protected:
     void ReturnForConsideration(ElementId el) {
@@ -333,6 +444,19 @@ protected:
     virtual bool Proceed(ElementId /*el*/) const { return true; }
     virtual void PrepareIteration(double /*iter_run_progress*/ = 1.) {}
 
+    /**
+     * Preliminary read-only check of the element, called concurrently in parallel mode.
+     * ProcessChecked is called only for elements passing the check.
+     */
+    virtual bool Check(ElementId /*el*/) const { return true; }
+
+    /**
+     * Processing of the element which passed Check in parallel mode. Check depends only on
+     * the neighbourhood of the element, which is not changed by the rest of the batch,
+     * so the check does not need to be repeated. Falls back to Process by default.
+     */
+    virtual bool ProcessChecked(ElementId el) { return Process(el); }
+
 public:
 
     PersistentProcessingAlgorithm(Graph& g,
@@ -343,10 +467,21 @@ public:
             PersistentAlgorithmBase<Graph>(g),
             interest_el_finder_(interest_el_finder),
             it_(g, true, comp, canonical_only),
-            tracking_(track_changes) {
+            comp_(comp),
+            tracking_(track_changes),
+            parallel_batch_(0) {
         it_.Detach();
     }
 
+    /**
+     * Enables parallel mode: elements are taken in batches of up to batch_size ones
+     * with disjoint vertex neighbourhoods, which are checked in parallel.
+     * @param batch_size zero batch size switches back to sequential mode
+     */
+    void EnableParallelProcessing(size_t batch_size = 10000) {
+        parallel_batch_ = batch_size;
+    }
+
     size_t Run(bool force_primary_launch = false,
                double iter_run_progress = 1.) override {
         bool primary_launch = force_primary_launch ;
@@ -369,19 +504,8 @@ public:
         //PrepareIteration(std::min(curr_iteration_, total_iteration_estimate_ - 1), total_iteration_estimate_);
         PrepareIteration(iter_run_progress);
 
-        size_t triggered = 0;
         TRACE("Start processing");
-        for (; !it_.IsEnd(); ++it_) {
-            ElementId el = *it_;
-            if (!Proceed(el)) {
-                TRACE("Proceed condition turned false on element " << this->g().str(el));
-                it_.ReleaseCurrent();
-                break;
-            }
-            TRACE("Processing edge " << this->g().str(el));
-            if (Process(el))
-                triggered++;
-        }
+        size_t triggered = parallel_batch_ ? ProcessInParallel() : ProcessSequentially();
         TRACE("Finished processing. Triggered = " << triggered);
         if (!tracking_)
             it_.Detach();
@@ -406,6 +530,10 @@ class ParallelEdgeRemovingAlgorithm : public PersistentProcessingAlgorithm<Graph
 
 protected:
 
+    bool Check(EdgeId e) const override {
+        return remove_condition_(e);
+    }
+
     bool Process(EdgeId e) override {
         TRACE("Checking edge " << this->g().str(e) << " for the removal condition");
         if (remove_condition_(e)) {
@@ -417,6 +545,12 @@ protected:
         return false;
     }
 
+    bool ProcessChecked(EdgeId e) override {
+        TRACE("Removing checked edge " << this->g().str(e));
+        edge_remover_.DeleteEdge(e);
+        return true;
+    }
+
 public:
     ParallelEdgeRemovingAlgorithm(Graph& g,
                                   func::TypedPredicate<EdgeId> remove_condition,
@@ -461,6 +595,10 @@ public:
               disconnector_(g, removal_handler) {
     }
 
+    bool Check(EdgeId e) const override {
+        return condition_(e);
+    }
+
     bool Process(EdgeId e) override {
         if (condition_(e)) {
             disconnector_(e);
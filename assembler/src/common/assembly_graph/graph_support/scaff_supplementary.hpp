@@ -111,6 +111,10 @@ public:
 class UsedUniqueStorage {
     set<EdgeId> used_;
     const ScaffoldingUniqueEdgeStorage& unique_;
+    //Overlay mode: edges used in the base storage are also considered used,
+    //every checked unique edge is appended to footprint_
+    const UsedUniqueStorage *base_;
+    std::vector<EdgeId> *footprint_;
 
 public:
     UsedUniqueStorage(const UsedUniqueStorage&) = delete;
@@ -120,7 +124,11 @@ public:
     UsedUniqueStorage& operator=(UsedUniqueStorage&&) = default;
 
     explicit UsedUniqueStorage(const ScaffoldingUniqueEdgeStorage& unique):
-            unique_(unique) {}
+            unique_(unique), base_(nullptr), footprint_(nullptr) {}
+
+    //Overlay over the base storage, which is never modified through the overlay
+    UsedUniqueStorage(const UsedUniqueStorage& base, std::vector<EdgeId> *footprint):
+            unique_(base.unique_), base_(&base), footprint_(footprint) {}
 
     void insert(EdgeId e) {
         if (unique_.IsUnique(e)) {
@@ -134,7 +142,20 @@ public:
 //    }
 
     bool IsUsedAndUnique(EdgeId e) const {
-        return (unique_.IsUnique(e) && used_.find(e) != used_.end());
+        if (!unique_.IsUnique(e))
+            return false;
+        if (footprint_)
+            footprint_->push_back(e);
+        return used_.find(e) != used_.end() || (base_ && base_->IsUsedAndUnique(e));
+    }
+
+    //Edges marked as used in this storage (not in the base one)
+    const set<EdgeId>& used() const {
+        return used_;
+    }
+
+    void clear() {
+        used_.clear();
     }
 
     bool UniqueCheckEnabled() const {
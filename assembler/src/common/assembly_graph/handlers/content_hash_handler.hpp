@@ -0,0 +1,64 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "assembly_graph/core/action_handlers.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace omnigraph {
+
+/**
+ * @brief Hash of the graph content (edge ids and sequences) maintained on edge additions
+ *        and deletions. The hash is a sum of per-edge hashes, so it does not depend on
+ *        the order of events and could be updated concurrently.
+ */
+template<class Graph>
+class GraphContentHash : public GraphActionHandler<Graph> {
+    typedef typename Graph::EdgeId EdgeId;
+
+    std::atomic<uint64_t> hash_;
+
+    static uint64_t Finalize(uint64_t h) {
+        // splitmix64 finalizer, so the sums of the edge hashes are well distributed
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    uint64_t EdgeHash(EdgeId e) const {
+        const auto &s = this->g().EdgeNucls(e);
+        uint64_t h = 0xcbf29ce484222325ULL ^ s.size();
+        for (size_t i = 0; i < s.size(); ++i)
+            h = (h ^ s[i]) * 0x100000001b3ULL;
+        return Finalize(h ^ Finalize(this->g().int_id(e)));
+    }
+
+public:
+    GraphContentHash(const Graph &g)
+            : GraphActionHandler<Graph>(g, "GraphContentHash"), hash_(Finalize(g.k())) {
+        for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+            hash_ += EdgeHash(*it);
+    }
+
+    uint64_t hash() const {
+        return hash_;
+    }
+
+    void HandleAdd(EdgeId e) override {
+        hash_ += EdgeHash(e);
+    }
+
+    void HandleDelete(EdgeId e) override {
+        hash_ -= EdgeHash(e);
+    }
+};
+
+}
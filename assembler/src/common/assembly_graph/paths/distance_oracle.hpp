@@ -0,0 +1,183 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "path_processor.hpp"
+#include "assembly_graph/core/action_handlers.hpp"
+#include "utils/parallel/openmp_wrapper.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace omnigraph {
+
+/**
+ * @brief Precomputed lengths of the paths (up to max_length) between the chosen pairs of vertices.
+ *        The lengths are exactly the ones reported by PathProcessor with the same bound,
+ *        so the oracle could replace PathProcessor queries for these pairs. Queries are grouped
+ *        by the source vertex, so a single Dijkstra run is shared by all the targets of the source.
+ *        Data is kept in CSR layout: source -> sorted range of targets -> sorted range of lengths.
+ *        Any change of the graph edges invalidates the oracle.
+ */
+template<class Graph>
+class GraphDistanceOracle : public GraphActionHandler<Graph> {
+    typedef typename Graph::VertexId VertexId;
+    typedef typename Graph::EdgeId EdgeId;
+    typedef std::vector<std::vector<size_t>> TargetLengths;
+
+    size_t max_length_;
+    bool valid_;
+
+    std::vector<size_t> sources_;
+    std::vector<size_t> source_offsets_;
+    std::vector<size_t> targets_;
+    std::vector<size_t> target_offsets_;
+    std::vector<uint32_t> lengths_;
+
+    TargetLengths Compute(VertexId source, const std::vector<VertexId> &targets) const {
+        TargetLengths answer;
+        PathProcessor<Graph> processor(this->g(), source, max_length_);
+        for (VertexId target : targets) {
+            DistancesLengthsCallback<Graph> callback(this->g());
+            processor.Process(target, 0, max_length_, callback);
+            answer.push_back(callback.distances());
+        }
+        return answer;
+    }
+
+    //Position of the source in sources_ or sources_.size()
+    size_t FindSource(VertexId v) const {
+        auto it = std::lower_bound(sources_.begin(), sources_.end(), this->g().int_id(v));
+        if (it == sources_.end() || *it != this->g().int_id(v))
+            return sources_.size();
+        return it - sources_.begin();
+    }
+
+    void Invalidate() {
+        if (!valid_)
+            return;
+        TRACE("Graph changed, distance oracle invalidated");
+        valid_ = false;
+        sources_.clear();
+        source_offsets_.clear();
+        targets_.clear();
+        target_offsets_.clear();
+        lengths_.clear();
+    }
+
+public:
+    GraphDistanceOracle(const Graph &g, size_t max_length)
+            : GraphActionHandler<Graph>(g, "GraphDistanceOracle"),
+              max_length_(max_length), valid_(false) {
+        VERIFY(max_length_ < std::numeric_limits<uint32_t>::max());
+    }
+
+    /**
+     * @brief Computes the path lengths for the given (source, target) pairs in parallel,
+     *        replacing the previous data.
+     */
+    void Build(std::vector<std::pair<VertexId, VertexId>> queries, size_t nthreads) {
+        Invalidate();
+        std::sort(queries.begin(), queries.end(),
+                  [this] (const std::pair<VertexId, VertexId> &a, const std::pair<VertexId, VertexId> &b) {
+                      return std::make_pair(this->g().int_id(a.first), this->g().int_id(a.second)) <
+                             std::make_pair(this->g().int_id(b.first), this->g().int_id(b.second));
+                  });
+        queries.erase(std::unique(queries.begin(), queries.end()), queries.end());
+
+        std::vector<VertexId> sources;
+        std::vector<std::vector<VertexId>> targets;
+        for (const auto &query : queries) {
+            if (sources.empty() || sources.back() != query.first) {
+                sources.push_back(query.first);
+                targets.emplace_back();
+            }
+            targets.back().push_back(query.second);
+        }
+
+        std::vector<TargetLengths> computed(sources.size());
+        #pragma omp parallel for num_threads(nthreads) schedule(guided, 10)
+        for (size_t i = 0; i < sources.size(); ++i)
+            computed[i] = Compute(sources[i], targets[i]);
+
+        source_offsets_.push_back(0);
+        target_offsets_.push_back(0);
+        for (size_t i = 0; i < sources.size(); ++i) {
+            sources_.push_back(this->g().int_id(sources[i]));
+            for (size_t j = 0; j < targets[i].size(); ++j) {
+                targets_.push_back(this->g().int_id(targets[i][j]));
+                for (size_t length : computed[i][j])
+                    lengths_.push_back((uint32_t) length);
+                target_offsets_.push_back(lengths_.size());
+            }
+            source_offsets_.push_back(targets_.size());
+            TargetLengths().swap(computed[i]);
+        }
+        valid_ = true;
+
+        INFO("Distance oracle built for " << sources_.size() << " vertices, "
+             << targets_.size() << " vertex pairs, " << lengths_.size() << " distances");
+    }
+
+    bool valid() const {
+        return valid_;
+    }
+
+    size_t max_length() const {
+        return max_length_;
+    }
+
+    /**
+     * @brief Appends the sorted lengths of the paths from source to target if the pair was precomputed
+     *        with the same length bound, otherwise returns false.
+     */
+    bool GetLengths(VertexId source, VertexId target, size_t max_length, std::vector<size_t> &lengths) const {
+        if (!valid_ || max_length != max_length_)
+            return false;
+        size_t pos = FindSource(source);
+        if (pos == sources_.size())
+            return false;
+
+        auto begin = targets_.begin() + source_offsets_[pos], end = targets_.begin() + source_offsets_[pos + 1];
+        auto it = std::lower_bound(begin, end, this->g().int_id(target));
+        if (it == end || *it != this->g().int_id(target))
+            return false;
+
+        size_t idx = it - targets_.begin();
+        lengths.insert(lengths.end(),
+                       lengths_.begin() + target_offsets_[idx], lengths_.begin() + target_offsets_[idx + 1]);
+        return true;
+    }
+
+    void HandleAdd(EdgeId /*e*/) override {
+        Invalidate();
+    }
+
+    void HandleDelete(EdgeId /*e*/) override {
+        Invalidate();
+    }
+
+    void HandleMerge(const std::vector<EdgeId> & /*old_edges*/, EdgeId /*new_edge*/) override {
+        Invalidate();
+    }
+
+    void HandleGlue(EdgeId /*new_edge*/, EdgeId /*edge1*/, EdgeId /*edge2*/) override {
+        Invalidate();
+    }
+
+    void HandleSplit(EdgeId /*old_edge*/, EdgeId /*new_edge_1*/, EdgeId /*new_edge_2*/) override {
+        Invalidate();
+    }
+
+private:
+    DECL_LOGGER("GraphDistanceOracle");
+};
+
+}
@@ -214,6 +214,11 @@ public:
         return error_code;
     }
 
+    //Vertices reachable from the start within the length bound (sorted)
+    vector<VertexId> ReachedVertices() const {
+        return dijkstra_.ReachedVertices();
+    }
+
 private:
     static const size_t MAX_CALL_CNT = 3000;
     static const size_t MAX_DIJKSTRA_VERTICES = 3000;
@@ -16,17 +16,27 @@
 namespace io {
 
 inline
-PairedStreamPtr paired_easy_reader(const SequencingLibrary<debruijn_graph::config::LibraryData> &lib,
-                                   bool followed_by_rc,
-                                   size_t insert_size,
-                                   bool use_orientation = true,
-                                   OffsetType offset_type = PhredOffset) {
+ReadStreamList<PairedRead> paired_easy_readers(const SequencingLibrary<debruijn_graph::config::LibraryData> &lib,
+                                               bool followed_by_rc,
+                                               size_t insert_size,
+                                               bool use_orientation = true,
+                                               OffsetType offset_type = PhredOffset) {
     ReadStreamList<PairedRead> streams;
     for (auto read_pair : lib.paired_reads()) {
         streams.push_back(PairedEasyStream(read_pair.first, read_pair.second, followed_by_rc, insert_size,
                                            use_orientation, lib.orientation(), offset_type));
     }
-    return MultifileWrap<PairedRead>(streams);
+    return streams;
+}
+
+inline
+PairedStreamPtr paired_easy_reader(const SequencingLibrary<debruijn_graph::config::LibraryData> &lib,
+                                   bool followed_by_rc,
+                                   size_t insert_size,
+                                   bool use_orientation = true,
+                                   OffsetType offset_type = PhredOffset) {
+    return MultifileWrap<PairedRead>(
+            paired_easy_readers(lib, followed_by_rc, insert_size, use_orientation, offset_type));
 }
 
 inline
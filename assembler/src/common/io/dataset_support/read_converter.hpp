@@ -80,24 +80,24 @@ class ReadConverter {
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
 
-        PairedStreamPtr paired_reader = paired_easy_reader(lib, false, 0, false, PhredOffset);
-        ReadStreamStat read_stat = paired_converter.ToBinary(*paired_reader, lib.orientation());
+        auto paired_readers = paired_easy_readers(lib, false, 0, false, PhredOffset);
+        ReadStreamStat read_stat = paired_converter.ToBinary(paired_readers, lib.orientation());
         read_stat.read_count *= 2;
 
         INFO("Converting single reads");
         BinaryWriter single_converter(data.binary_reads_info.single_read_prefix,
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
-        SingleStreamPtr single_reader = single_easy_reader(lib, false, false);
-        read_stat.merge(single_converter.ToBinary(*single_reader));
+        auto single_readers = single_easy_readers(lib, false, false);
+        read_stat.merge(single_converter.ToBinary(single_readers));
 
         data.unmerged_read_length = read_stat.max_len;
         INFO("Converting merged reads");
         BinaryWriter merged_converter(data.binary_reads_info.merged_read_prefix,
                                       data.binary_reads_info.chunk_num,
                                       data.binary_reads_info.buffer_size);
-        SingleStreamPtr merged_reader = merged_easy_reader(lib, false);
-        auto merged_stats = merged_converter.ToBinary(*merged_reader);
+        auto merged_readers = merged_easy_readers(lib, false);
+        auto merged_stats = merged_converter.ToBinary(merged_readers);
 
         data.merged_read_length = merged_stats.max_len;
         read_stat.merge(merged_stats);
@@ -0,0 +1,188 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// Buffered writer which keeps a single open descriptor and performs the actual
+// write(2) calls from a background thread. Two buffers are used: while one is
+// being flushed, the caller fills the other one. Optionally the file could be
+// opened with O_DIRECT, then all writes but the very last one are aligned.
+class AsyncBufferedWriter {
+    static const size_t Alignment = 4096;
+
+    int fd_;
+    std::string file_name_;
+    bool direct_;
+    size_t buffer_size_;
+    uint8_t *buffers_[2];
+    unsigned current_;
+    size_t fill_;
+    size_t written_;
+
+    std::thread writer_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    unsigned pending_idx_;
+    size_t pending_;
+    bool done_;
+    int error_;
+
+    AsyncBufferedWriter(const AsyncBufferedWriter &) = delete;
+    AsyncBufferedWriter &operator=(const AsyncBufferedWriter &) = delete;
+
+    int WriteAll(const uint8_t *data, size_t amount) {
+        if (direct_ && amount % Alignment) {
+#ifdef O_DIRECT
+            // Unaligned tail could not be written in direct mode
+            int flags = fcntl(fd_, F_GETFL);
+            fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+#endif
+            direct_ = false;
+        }
+
+        while (amount) {
+            ssize_t res = ::write(fd_, data, amount);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                return errno;
+            }
+            data += res;
+            amount -= (size_t) res;
+        }
+
+        return 0;
+    }
+
+    void WriterLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            cv_.wait(lock, [this] { return pending_ || done_; });
+            if (!pending_)
+                break;
+
+            const uint8_t *data = buffers_[pending_idx_];
+            size_t amount = pending_;
+            lock.unlock();
+            int res = WriteAll(data, amount);
+            lock.lock();
+
+            if (res && !error_)
+                error_ = res;
+            pending_ = 0;
+            cv_.notify_all();
+        }
+    }
+
+    // Hands the current buffer to the writer thread and switches to the other one
+    void Submit() {
+        if (!fill_)
+            return;
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_ == 0; });
+        VERIFY_MSG(!error_,
+                   "write(2) failed. Reason: " << strerror(error_) << ". Error code: " << error_ << ". File: " << file_name_);
+        pending_idx_ = current_;
+        pending_ = fill_;
+        cv_.notify_all();
+
+        current_ ^= 1;
+        fill_ = 0;
+    }
+
+public:
+    AsyncBufferedWriter(const std::string &file_name,
+                        size_t buffer_size = 8 * 1024 * 1024,
+                        bool direct = false)
+            : fd_(-1), file_name_(file_name), direct_(direct),
+              buffer_size_((buffer_size + Alignment - 1) / Alignment * Alignment),
+              buffers_{nullptr, nullptr}, current_(0), fill_(0), written_(0),
+              pending_idx_(0), pending_(0), done_(false), error_(0) {
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+        if (direct_)
+            flags |= O_DIRECT;
+#else
+        direct_ = false;
+#endif
+        fd_ = ::open(file_name_.c_str(), flags, (mode_t) 0660);
+        if (fd_ == -1 && direct_) {
+            // Filesystem might not support direct I/O, fallback to ordinary one
+            direct_ = false;
+            fd_ = ::open(file_name_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, (mode_t) 0660);
+        }
+        VERIFY_MSG(fd_ != -1,
+                   "open(2) failed. Reason: " << strerror(errno) << ". Error code: " << errno << ". File: " << file_name_);
+
+        for (auto &buffer : buffers_) {
+            int res = posix_memalign((void **) &buffer, Alignment, buffer_size_);
+            VERIFY_MSG(res == 0, "Cannot allocate " << buffer_size_ << " bytes of I/O buffer");
+        }
+
+        writer_ = std::thread(&AsyncBufferedWriter::WriterLoop, this);
+    }
+
+    ~AsyncBufferedWriter() {
+        close();
+        free(buffers_[0]);
+        free(buffers_[1]);
+    }
+
+    void write(const void *buf, size_t amount) {
+        const uint8_t *data = (const uint8_t *) buf;
+        while (amount) {
+            size_t chunk = std::min(amount, buffer_size_ - fill_);
+            memcpy(buffers_[current_] + fill_, data, chunk);
+            fill_ += chunk;
+            data += chunk;
+            amount -= chunk;
+            written_ += chunk;
+
+            if (fill_ == buffer_size_)
+                Submit();
+        }
+    }
+
+    // Flushes all the buffered data and closes the file. Called from dtor as well.
+    void close() {
+        if (fd_ == -1)
+            return;
+
+        Submit();
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return pending_ == 0; });
+            done_ = true;
+            cv_.notify_all();
+        }
+        writer_.join();
+
+        VERIFY_MSG(!error_,
+                   "write(2) failed. Reason: " << strerror(error_) << ". Error code: " << error_ << ". File: " << file_name_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    size_t bytes_written() const { return written_; }
+
+    const std::string &file_name() const { return file_name_; }
+};
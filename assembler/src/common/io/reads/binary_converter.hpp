@@ -13,10 +13,17 @@
  */
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "utils/verify.hpp"
 #include "ireader.hpp"
+#include "read_stream_vector.hpp"
 #include "single_read.hpp"
 #include "paired_read.hpp"
 #include "orientation.hpp"
@@ -53,62 +60,132 @@ public:
     }
 };
 
+// Blocking single producer / single consumer handoff of the read chunks
+template<class Chunk>
+class ChunkHandoff {
+    static const size_t CAPACITY = 2;
+
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::deque<Chunk> chunks_;
+    bool closed_ = false;
+
+public:
+    void Put(Chunk &&chunk) {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this] { return chunks_.size() < CAPACITY; });
+        chunks_.push_back(std::move(chunk));
+        cv_.notify_all();
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(lock_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+
+    // Returns false once the handoff is closed and all the chunks are taken
+    bool Take(Chunk &chunk) {
+        std::unique_lock<std::mutex> lock(lock_);
+        cv_.wait(lock, [this] { return !chunks_.empty() || closed_; });
+        if (chunks_.empty())
+            return false;
+        chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        cv_.notify_all();
+        return true;
+    }
+};
+
 class BinaryWriter {
+    typedef std::vector<std::ofstream*> Shards;
+
     const std::string file_name_prefix_;
     size_t file_num_;
-    std::vector<std::ofstream*> file_ds_;
+    Shards file_ds_;
     size_t buf_size_;
 
+    // Reads are parsed by several producers (one input stream at a time each) and
+    // collected into chunks. Chunk c of stream s goes to shard (s + c) % file_num,
+    // and every writer thread takes the chunks of its shard stream by stream, so
+    // the output does not depend on the thread scheduling. Producers block when
+    // the writers are behind: at most CAPACITY chunks per shard are kept for each
+    // stream being parsed, and chunks are sized to keep it within buf_size per shard.
     template<class Writer, class Read>
-    void FlushBuffer(const std::vector<Read>& buffer, const Writer& read_writer, std::ostream& file) {
-        for (const Read &r : buffer) {
-            read_writer.Write(file, r);
-        }
-    }
-
-    template<class Writer, class Read>
-    ReadStreamStat ToBinary(const Writer &writer, io::ReadStream<Read> &stream, size_t buf_size) {
-        size_t buffer_reads = buf_size / (sizeof (Read) * 4);
-        size_t reads_to_flush = buffer_reads * file_num_;
+    ReadStreamStat ToBinary(const Writer &writer, io::ReadStreamList<Read> &streams, size_t buf_size) {
+        typedef std::vector<Read> Chunk;
+        typedef ChunkHandoff<Chunk> Handoff;
 
-        std::vector<std::vector<Read>> buf(file_num_, std::vector<Read>(buffer_reads) );
         std::vector<ReadStreamStat> read_stats(file_num_);
-        std::vector<size_t> current_buf_sizes(file_num_, 0);
-        size_t read_count = 0;
-
         for (size_t i = 0; i < file_num_; ++i) {
             file_ds_[i]->seekp(0);
             read_stats[i].write(*file_ds_[i]);
         }
 
-        size_t buf_index;
-        while (!stream.eof()) {
-            buf_index = read_count % file_num_;
-
-            Read& r = buf[buf_index][current_buf_sizes[buf_index]];
-            stream >> r;
-            read_stats[buf_index].increase(r);
-
-            ++current_buf_sizes[buf_index];
-            VERBOSE_POWER(++read_count, " reads processed");
+        size_t producers = std::max(std::min(streams.size(), file_num_), size_t(1));
+        size_t buffer_reads = buf_size / (sizeof (Read) * 4);
+        size_t chunk_reads = std::max(buffer_reads / (2 * producers), size_t(1));
+
+        // handoffs[s * file_num + k] passes the chunks of stream s to shard k
+        std::vector<std::unique_ptr<Handoff>> handoffs(streams.size() * file_num_);
+        for (auto &handoff : handoffs)
+            handoff.reset(new Handoff());
+
+        std::atomic<size_t> next_stream(0), read_count(0);
+        auto produce = [&]() {
+            for (size_t idx = next_stream++; idx < streams.size(); idx = next_stream++) {
+                auto &stream = streams[idx];
+                size_t shard = idx % file_num_;
+                Chunk chunk;
+                chunk.reserve(chunk_reads);
+                while (!stream.eof()) {
+                    chunk.emplace_back();
+                    stream >> chunk.back();
+                    VERBOSE_POWER(++read_count, " reads processed");
+
+                    if (chunk.size() == chunk_reads) {
+                        handoffs[idx * file_num_ + shard]->Put(std::move(chunk));
+                        shard = (shard + 1) % file_num_;
+                        chunk = Chunk();
+                        chunk.reserve(chunk_reads);
+                    }
+                }
 
-            if (read_count % reads_to_flush == 0) {
-                for (size_t i = 0; i < file_num_; ++i) {
-                    for (const Read &read : buf[i]) {
-                        writer.Write(*file_ds_[i], read);
+                if (!chunk.empty())
+                    handoffs[idx * file_num_ + shard]->Put(std::move(chunk));
+                for (size_t i = 0; i < file_num_; ++i)
+                    handoffs[idx * file_num_ + i]->Close();
+            }
+        };
+
+        auto consume = [&](size_t shard) {
+            Chunk chunk;
+            for (size_t idx = 0; idx < streams.size(); ++idx) {
+                Handoff &handoff = *handoffs[idx * file_num_ + shard];
+                while (handoff.Take(chunk)) {
+                    for (const Read &r : chunk) {
+                        read_stats[shard].increase(r);
+                        writer.Write(*file_ds_[shard], r);
                     }
-                    current_buf_sizes[i] = 0;
                 }
             }
-        }
+        };
+
+        // Producers take the streams in order, so the earliest unfinished stream is
+        // always being parsed, and the writers waiting for it cannot deadlock
+        std::vector<std::thread> writers, readers;
+        for (size_t i = 0; i < file_num_; ++i)
+            writers.emplace_back(consume, i);
+        for (size_t i = 0; i < producers; ++i)
+            readers.emplace_back(produce);
+
+        for (auto &t : readers)
+            t.join();
+        for (auto &t : writers)
+            t.join();
 
         ReadStreamStat result;
         for (size_t i = 0; i < file_num_; ++i) {
-            buf[i].resize(current_buf_sizes[i]);
-            for (const Read &r : buf[i]) {
-                writer.Write(*file_ds_[i], r);
-            }
-
             file_ds_[i]->seekp(0);
             read_stats[i].write(*file_ds_[i]);
             result.merge(read_stats[i]);
@@ -118,6 +195,13 @@ class BinaryWriter {
         return result;
     }
 
+    template<class Writer, class Read>
+    ReadStreamStat ToBinary(const Writer &writer, io::ReadStream<Read> &stream, size_t buf_size) {
+        // Stream is not owned by us, so wrap it without deleter
+        io::ReadStreamList<Read> streams(typename io::ReadStreamList<Read>::ReaderPtrT(&stream, [](io::ReadStream<Read> *) {}));
+        return ToBinary(writer, streams, buf_size);
+    }
+
 public:
 
     BinaryWriter(const std::string& file_name_prefix, size_t file_num,
@@ -142,6 +226,17 @@ public:
     }
 
 
+    ReadStreamStat ToBinary(io::ReadStreamList<io::SingleRead>& streams) {
+        ReadBinaryWriter<io::SingleRead> read_writer;
+        return ToBinary(read_writer, streams, buf_size_ / file_num_);
+    }
+
+    ReadStreamStat ToBinary(io::ReadStreamList<io::PairedRead>& streams,
+                            LibraryOrientation orientation = LibraryOrientation::Undefined) {
+        PairedReadBinaryWriter<io::PairedRead> read_writer(orientation);
+        return ToBinary(read_writer, streams, buf_size_ / (2 * file_num_));
+    }
+
     ReadStreamStat ToBinary(io::ReadStream<io::SingleReadSeq>& stream) {
         ReadBinaryWriter<io::SingleReadSeq> read_writer;
         return ToBinary(read_writer, stream, buf_size_ / file_num_);
@@ -7,57 +7,85 @@
 
 #pragma once
 
-#include <fstream>
-
 #include "utils/verify.hpp"
+#include "io/kmers/mmapped_reader.hpp"
 #include "ireader.hpp"
 #include "single_read.hpp"
 #include "paired_read.hpp"
 
+#include <vector>
+#include <cstring>
+
 namespace io {
 
-class BinaryFileSingleStream: public ReadStream<SingleReadSeq> {
-    std::ifstream stream_;
+// Binary reads file mapped into memory as a whole. Records are decoded right
+// from the mapped region, so repeated passes over the same file (reset())
+// cost neither syscalls nor copies through the stream buffers.
+template<class Read>
+class MappedBinaryStream: public ReadStream<Read> {
+    std::string fname_;
+    MMappedReader file_;
     ReadStreamStat read_stat_;
     size_t current_;
+    const uint8_t *pos_;
 
     void Init() {
-        stream_.clear();
-        stream_.seekg(0);
-        VERIFY(stream_.good());
-        read_stat_.read(stream_);
+        if (!file_.data())
+            file_ = MMappedReader(fname_, /* unlink */ false, /* blocksize */ -1ULL);
+        VERIFY_MSG(file_.size() >= 3 * sizeof(size_t), "Invalid binary reads file " << fname_);
+
+        pos_ = (const uint8_t *) file_.data();
+        memcpy(&read_stat_.read_count, pos_, sizeof(read_stat_.read_count));
+        pos_ += sizeof(read_stat_.read_count);
+        memcpy(&read_stat_.max_len, pos_, sizeof(read_stat_.max_len));
+        pos_ += sizeof(read_stat_.max_len);
+        memcpy(&read_stat_.total_len, pos_, sizeof(read_stat_.total_len));
+        pos_ += sizeof(read_stat_.total_len);
         current_ = 0;
     }
 
-public:
-
-    BinaryFileSingleStream(const std::string& file_name_prefix, size_t file_num) {
-        std::string fname;
-        fname = file_name_prefix + "_" + std::to_string(file_num) + ".seq";
-        stream_.open(fname.c_str(), std::ios_base::binary | std::ios_base::in);
+protected:
+    virtual const uint8_t *Decode(const uint8_t *data, Read &read) const = 0;
 
-        Init();
+public:
+    MappedBinaryStream(const std::string& file_name_prefix, size_t file_num)
+            : fname_(file_name_prefix + "_" + std::to_string(file_num) + ".seq"),
+              current_(0), pos_(nullptr) {
     }
 
     bool is_open() override {
-        return stream_.is_open();
+        return file_.data() != nullptr;
     }
 
     bool eof() override {
-        return current_ == read_stat_.read_count;
+        return current_ >= read_stat_.read_count;
     }
 
-    BinaryFileSingleStream& operator>>(SingleReadSeq& read) override {
-        read.BinRead(stream_);
+    MappedBinaryStream& operator>>(Read& read) override {
         VERIFY(current_ < read_stat_.read_count);
+        pos_ = Decode(pos_, read);
 
         ++current_;
         return *this;
     }
 
+    /*
+     * Decodes up to max_reads next reads at once into reads (replacing its
+     * content) without a virtual call per read. Returns the number of reads.
+     */
+    size_t ReadBatch(std::vector<Read> &reads, size_t max_reads) {
+        size_t cnt = std::min(max_reads, read_stat_.read_count - current_);
+        reads.resize(cnt);
+        for (Read &read : reads)
+            pos_ = Decode(pos_, read);
+
+        current_ += cnt;
+        return cnt;
+    }
+
     void close() override {
         current_ = 0;
-        stream_.close();
+        file_ = MMappedReader();
     }
 
     void reset() override {
@@ -66,6 +94,19 @@ public:
 
 };
 
+class BinaryFileSingleStream: public MappedBinaryStream<SingleReadSeq> {
+protected:
+    const uint8_t *Decode(const uint8_t *data, SingleReadSeq &read) const override {
+        return read.BinRead(data);
+    }
+
+public:
+    BinaryFileSingleStream(const std::string& file_name_prefix, size_t file_num)
+            : MappedBinaryStream<SingleReadSeq>(file_name_prefix, file_num) {
+        reset();
+    }
+};
+
 //returns FF oriented paired reads
 class BinaryUnmergingPairedStream: public ReadStream<PairedReadSeq> {
     BinaryFileSingleStream stream_;
@@ -126,56 +167,19 @@ public:
 
 };
 
-class BinaryFilePairedStream: public ReadStream<PairedReadSeq> {
-    std::ifstream stream_;
+class BinaryFilePairedStream: public MappedBinaryStream<PairedReadSeq> {
     size_t insert_size_;
-    ReadStreamStat read_stat_;
-    size_t current_;
 
-    void Init() {
-        stream_.clear();
-        stream_.seekg(0);
-        VERIFY(stream_.good());
-        read_stat_.read(stream_);
-        current_ = 0;
+protected:
+    const uint8_t *Decode(const uint8_t *data, PairedReadSeq &read) const override {
+        return read.BinRead(data, insert_size_);
     }
 
 public:
-
-    BinaryFilePairedStream(const std::string& file_name_prefix, size_t file_num, size_t insert_szie): stream_(), insert_size_ (insert_szie) {
-        std::string fname;
-        fname = file_name_prefix + "_" + std::to_string(file_num) + ".seq";
-        stream_.open(fname.c_str(), std::ios_base::binary | std::ios_base::in);
-
-        Init();
+    BinaryFilePairedStream(const std::string& file_name_prefix, size_t file_num, size_t insert_size)
+            : MappedBinaryStream<PairedReadSeq>(file_name_prefix, file_num), insert_size_(insert_size) {
+        reset();
     }
-
-    bool is_open() override {
-        return stream_.is_open();
-    }
-
-    bool eof() override {
-        return current_ >= read_stat_.read_count;
-    }
-
-    BinaryFilePairedStream& operator>>(PairedReadSeq& read) override {
-        read.BinRead(stream_, insert_size_);
-        VERIFY(current_ < read_stat_.read_count);
-
-        ++current_;
-        return *this;
-    }
-
-    void close() override {
-        current_ = 0;
-        stream_.close();
-    }
-
-
-    void reset() override {
-        Init();
-    }
-
 };
 
 }
@@ -97,6 +97,14 @@ public:
         return !file.fail();
     }
 
+    const uint8_t *BinRead(const uint8_t *data, size_t estimated_is) {
+        data = first_.BinRead(data);
+        data = second_.BinRead(data);
+
+        insert_size_ = estimated_is;
+        return data;
+    }
+
     bool BinWrite(std::ostream &file, bool rc1 = false, bool rc2 = false) const {
         first_.BinWrite(file, rc1);
         second_.BinWrite(file, rc2);
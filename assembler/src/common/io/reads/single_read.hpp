@@ -265,6 +265,14 @@ public:
         return !file.fail();
     }
 
+    const uint8_t *BinRead(const uint8_t *data) {
+        data = seq_.BinRead(data);
+        memcpy(&left_offset_, data, sizeof(left_offset_));
+        data += sizeof(left_offset_);
+        memcpy(&right_offset_, data, sizeof(right_offset_));
+        return data + sizeof(right_offset_);
+    }
+
     bool BinWrite(std::ostream &file, bool rc = false) const {
         if (rc)
             (!seq_).BinWrite(file);
@@ -11,6 +11,9 @@
 #include "assembly_graph/core/action_handlers.hpp"
 #include "assembly_graph/index/edge_info_updater.hpp"
 #include "edge_index_refiller.hpp"
+
+#include <algorithm>
+#include <unordered_set>
     
 namespace debruijn_graph {
 
@@ -29,6 +32,7 @@ public:
     typedef typename InnerIndex::KMer KMer;
     typedef typename InnerIndex::KMerIdx KMerIdx;
     typedef typename InnerIndex::KmerPos Value;
+    typedef typename InnerIndex::KeyWithHash KeyWithHash;
 
 private:
     InnerIndex inner_index_;
@@ -36,6 +40,19 @@ private:
     EdgeIndexRefiller refiller_;
     bool delete_index_;
 
+    // Edges not in the exclusion set, one per conjugate pair (edge events always come in pairs)
+    std::vector<EdgeId> CanonicalEdges(const std::vector<EdgeId> &edges,
+                                       const std::unordered_set<EdgeId> &excluded) const {
+        std::vector<EdgeId> answer;
+        for (EdgeId e : edges) {
+            if (e <= this->g().conjugate(e) && !excluded.count(e))
+                answer.push_back(e);
+        }
+        std::sort(answer.begin(), answer.end());
+        answer.erase(std::unique(answer.begin(), answer.end()), answer.end());
+        return answer;
+    }
+
 public:
     EdgeIndex(const Graph& g, const std::string &workdir)
             : omnigraph::GraphActionHandler<Graph>(g, "EdgeIndex"),
@@ -70,6 +87,34 @@ public:
         updater_.DeleteKmers(e);
     }
 
+    bool IsBatchable() const override {
+        return true;
+    }
+
+    void HandleBatch(const omnigraph::GraphEventBatch<typename Graph::VertexId, EdgeId> &batch) override {
+        // Edges both added and deleted inside the batch have never been indexed
+        std::unordered_set<EdgeId> added(batch.added_edges.begin(), batch.added_edges.end());
+        std::unordered_set<EdgeId> deleted(batch.deleted_edges.begin(), batch.deleted_edges.end());
+        auto to_delete = CanonicalEdges(batch.deleted_edges, added);
+        auto to_add = CanonicalEdges(batch.added_edges, deleted);
+
+        // Every k-mer (up to reverse complement) belongs to a single edge, edge and its conjugate
+        // share k-mers and are processed together. All stale entries are cleared before new ones are put.
+        #pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < to_delete.size(); ++i) {
+            updater_.DeleteKmers(to_delete[i]);
+            if (to_delete[i] != this->g().conjugate(to_delete[i]))
+                updater_.DeleteKmers(this->g().conjugate(to_delete[i]));
+        }
+
+        #pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < to_add.size(); ++i) {
+            updater_.UpdateKmers(to_add[i]);
+            if (to_add[i] != this->g().conjugate(to_add[i]))
+                updater_.UpdateKmers(this->g().conjugate(to_add[i]));
+        }
+    }
+
     bool contains(const KMer& kmer) const {
         VERIFY(this->IsAttached());
         return inner_index_.contains(inner_index_.ConstructKWH(kmer));
@@ -77,7 +122,10 @@ public:
 
     const pair<EdgeId, size_t> get(const KMer& kmer) const {
         VERIFY(this->IsAttached());
-        auto kwh = inner_index_.ConstructKWH(kmer);
+        return get(inner_index_.ConstructKWH(kmer));
+    }
+
+    const pair<EdgeId, size_t> get(const KeyWithHash& kwh) const {
         if (!inner_index_.contains(kwh)) {
             return make_pair(EdgeId(), -1u);
         } else {
@@ -86,6 +134,20 @@ public:
         }
     }
 
+    KeyWithHash ConstructKWH(const KMer& kmer) const {
+        VERIFY(this->IsAttached());
+        return inner_index_.ConstructKWH(kmer);
+    }
+
+    /**
+     * Computes the hash of the k-mer and prefetches its entry, so the
+     * following get() of the same key does not stall on the memory access
+     */
+    void Prefetch(const KeyWithHash& kwh) const {
+        if (inner_index_.valid(kwh))
+            __builtin_prefetch(&inner_index_.get_raw_value_reference(kwh));
+    }
+
     void Refill() {
         clear();
         refiller_.Refill(inner_index_, this->g());
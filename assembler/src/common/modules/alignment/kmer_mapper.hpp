@@ -29,6 +29,28 @@ class KmerMapper : public omnigraph::GraphActionHandler<Graph> {
     KMerMap mapping_;
     bool verification_on_;
     bool normalized_;
+    // Sum of the entry hashes, identifies the mapping content
+    uint64_t content_hash_;
+
+    static uint64_t EntryHash(const Kmer &kmer, const Seq &value) {
+        return kmer.GetHash(value.GetHash());
+    }
+
+    void Set(const Kmer &kmer, const Seq &value) {
+        const auto *rawval = mapping_.find(kmer);
+        if (rawval != nullptr)
+            content_hash_ -= EntryHash(kmer, Seq(k_, rawval));
+        mapping_.set(kmer, value);
+        content_hash_ += EntryHash(kmer, value);
+    }
+
+    void Erase(const Kmer &kmer) {
+        const auto *rawval = mapping_.find(kmer);
+        if (rawval == nullptr)
+            return;
+        content_hash_ -= EntryHash(kmer, Seq(k_, rawval));
+        mapping_.erase(kmer);
+    }
 
     bool CheckAllDifferent(const Sequence &old_s, const Sequence &new_s) const {
         std::set<Kmer> kmers;
@@ -50,7 +72,9 @@ public:
             base(g, "KmerMapper"),
             k_(unsigned(g.k() + 1)),
             mapping_(k_),
-            normalized_(false) {
+            verification_on_(true),
+            normalized_(false),
+            content_hash_(0) {
     }
 
     virtual ~KmerMapper() {}
@@ -92,7 +116,7 @@ public:
 //    }
 
     void Normalize(const Kmer &kmer) {
-        mapping_.set(kmer, Substitute(kmer));
+        Set(kmer, Substitute(kmer));
     }
 
     void RemapKmers(const Sequence &old_s, const Sequence &new_s) {
@@ -126,12 +150,12 @@ public:
                 // Special case of remapping back.
                 // Not sure that we actually need it
                 if (Substitute(new_kmer) == old_kmer)
-                    mapping_.erase(new_kmer);
+                    Erase(new_kmer);
                 else
                     continue;
             }
 
-            mapping_.set(old_kmer, new_kmer);
+            Set(old_kmer, new_kmer);
             normalized_ = false;
         }
     }
@@ -143,8 +167,19 @@ public:
 
     Kmer Substitute(const Kmer &kmer) const {
         VERIFY(this->IsAttached());
-        Kmer answer = kmer;
-        const auto *rawval = mapping_.find(answer);
+        const auto *rawval = mapping_.find(kmer);
+        if (rawval == nullptr)
+            return kmer;
+
+        // Normalization compresses the substitution chains,
+        // so every k-mer is mapped directly to its final substitution
+        Kmer answer(k_, rawval);
+        if (verification_on_)
+            VERIFY(answer != kmer);
+        if (normalized_)
+            return answer;
+
+        rawval = mapping_.find(answer);
         while (rawval != nullptr) {
             Seq val(k_, rawval);
             if (verification_on_)
@@ -181,7 +216,7 @@ public:
             Seq value(k_);
             Kmer::BinRead(file, &key);
             Seq::BinRead(file, &value);
-            mapping_.set(key, value);
+            Set(key, value);
         }
         normalized_ = false;
     }
@@ -193,8 +228,8 @@ public:
         }
 
         for (auto iter = begin(); iter != end(); ++iter) {
-            auto cmp = m.mapping_.find(iter.first());
-            if (cmp == m.mapping_.end() || cmp.second() != iter.second()) {
+            const auto *cmp = m.mapping_.find(iter->first);
+            if (cmp == nullptr || Seq(k_, cmp) != iter->second) {
                 return false;
             }
         }
@@ -203,6 +238,7 @@ public:
 
     void clear() {
         normalized_ = false;
+        content_hash_ = 0;
         return mapping_.clear();
     }
 
@@ -210,6 +246,10 @@ public:
         return mapping_.size();
     }
 
+    uint64_t content_hash() const {
+        return content_hash_;
+    }
+
     // "turn on = true" means turning of all verifies
     void SetUnsafeMode(bool turn_on) {
         verification_on_ = !turn_on;
@@ -0,0 +1,288 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "assembly_graph/paths/mapping_path.hpp"
+#include "io/kmers/mmapped_reader.hpp"
+#include "utils/filesystem/path_helper.hpp"
+#include "utils/logger/logger.hpp"
+#include "utils/verify.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace debruijn_graph {
+
+namespace mapping_cache {
+
+inline uint64_t Mix(uint64_t h, uint64_t v) {
+    // boost::hash_combine-like mixing, extended to 64 bits
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+inline uint64_t Hash(const Sequence &s, uint64_t h = 0) {
+    h = Mix(h, s.size());
+    for (size_t i = 0; i < s.size(); ++i)
+        h = (h ^ s[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+inline uint64_t Hash(const std::string &s, uint64_t h = 0) {
+    return Mix(h, std::hash<std::string>()(s));
+}
+
+inline void PutVarint(std::vector<uint8_t> &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+inline const uint8_t *GetVarint(const uint8_t *p, uint64_t &v) {
+    uint64_t res = 0;
+    unsigned shift = 0;
+    while (*p & 0x80) {
+        res |= uint64_t(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    v = res | (uint64_t(*p++) << shift);
+    return p;
+}
+
+}
+
+/**
+ * @brief On-disk storage of read mapping paths for a single library.
+ *        Paths are stored in batches identified by the stream index and the position
+ *        of the first read of the batch inside the stream. Every batch also keeps
+ *        the hash of the reads, so cache could not be replayed for the wrong reads.
+ *        The file header holds a key (graph and k-mer mapper content hashes, mapper, read type, etc).
+ *        If the existing file has the same key, the cache is opened for replaying,
+ *        otherwise it is (re)written. The file gets its final name only if it was
+ *        written completely; stale or mismatched caches are removed.
+ */
+template<class Graph>
+class MappingCache {
+    typedef typename Graph::EdgeId EdgeId;
+    typedef MappingPath<EdgeId> Path;
+
+    static const uint64_t Magic = 0x314843504d535053ULL; // "SPSMPCH1"
+
+    struct BatchHeader {
+        uint64_t stream;
+        uint64_t start;
+        uint64_t reads_hash;
+        uint64_t paths;
+        uint64_t bytes;
+    };
+
+    const Graph &g_;
+    std::string file_name_;
+    uint64_t key_;
+    bool replay_;
+    std::atomic<bool> broken_;
+
+    // Replay mode
+    MMappedReader reader_;
+    std::unordered_map<uint64_t, std::unordered_map<uint64_t, size_t>> batches_;
+    std::vector<EdgeId> edges_;
+
+    // Write mode
+    FILE *out_;
+    std::mutex lock_;
+
+    std::string tmp_file() const {
+        return file_name_ + ".tmp";
+    }
+
+    bool OpenReplay() {
+        if (!fs::FileExists(file_name_))
+            return false;
+
+        reader_ = MMappedReader(file_name_, false, -1ULL);
+        const uint8_t *data = (const uint8_t*) reader_.data();
+        size_t size = reader_.size();
+        uint64_t header[2];
+        if (size < sizeof(header))
+            return false;
+        memcpy(header, data, sizeof(header));
+        if (header[0] != Magic || header[1] != key_)
+            return false;
+
+        for (size_t pos = sizeof(header); pos < size; ) {
+            BatchHeader batch;
+            if (pos + sizeof(batch) > size)
+                return false;
+            memcpy(&batch, data + pos, sizeof(batch));
+            batches_[batch.stream][batch.start] = pos;
+            pos += sizeof(batch) + batch.bytes;
+        }
+
+        for (auto it = g_.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+            size_t id = g_.int_id(*it);
+            if (id >= edges_.size())
+                edges_.resize(id + 1);
+            edges_[id] = *it;
+        }
+
+        return true;
+    }
+
+    // Returns the pointer to the batch data or nullptr if there is no such batch
+    const uint8_t *FindBatch(size_t stream, size_t start, BatchHeader &batch) const {
+        auto sit = batches_.find(stream);
+        if (sit == batches_.end())
+            return nullptr;
+        auto bit = sit->second.find(start);
+        if (bit == sit->second.end())
+            return nullptr;
+
+        const uint8_t *pos = (const uint8_t*) reader_.data() + bit->second;
+        memcpy(&batch, pos, sizeof(batch));
+        return pos + sizeof(batch);
+    }
+
+public:
+    MappingCache(const Graph &g, const std::string &file_name, uint64_t key)
+            : g_(g), file_name_(file_name), key_(key), replay_(false), broken_(false), out_(nullptr) {
+        replay_ = OpenReplay();
+        if (replay_) {
+            INFO("Replaying read mappings from " << file_name_);
+            return;
+        }
+
+        reader_ = MMappedReader();
+        batches_.clear();
+        fs::remove_if_exists(file_name_);
+        out_ = fopen(tmp_file().c_str(), "wb");
+        if (!out_) {
+            WARN("Cannot create mapping cache " << tmp_file() << ", mappings will not be cached");
+            broken_ = true;
+            return;
+        }
+
+        uint64_t header[2] = { Magic, key_ };
+        if (fwrite(header, sizeof(header), 1, out_) != 1)
+            broken_ = true;
+    }
+
+    ~MappingCache() {
+        Finish();
+    }
+
+    bool replaying() const { return replay_; }
+
+    /**
+     * @brief Fetches the paths of the batch of reads. Returns false if there is no such
+     *        batch in the cache or it was stored for the other reads; such a cache
+     *        is invalidated and will be removed.
+     */
+    bool Fetch(size_t stream, size_t start, uint64_t reads_hash, std::vector<Path> &paths) {
+        if (!replay_ || broken_)
+            return false;
+
+        BatchHeader batch;
+        const uint8_t *pos = FindBatch(stream, start, batch);
+        if (!pos || batch.reads_hash != reads_hash) {
+            WARN("Mapping cache " << file_name_ << " does not match the reads and will be dropped");
+            broken_ = true;
+            return false;
+        }
+
+        paths.resize(batch.paths);
+        for (auto &path : paths) {
+            uint64_t n;
+            pos = mapping_cache::GetVarint(pos, n);
+            std::vector<EdgeId> edges(n);
+            std::vector<MappingRange> ranges(n);
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t id, is, il, ms, ml;
+                pos = mapping_cache::GetVarint(pos, id);
+                pos = mapping_cache::GetVarint(pos, is);
+                pos = mapping_cache::GetVarint(pos, il);
+                pos = mapping_cache::GetVarint(pos, ms);
+                pos = mapping_cache::GetVarint(pos, ml);
+                VERIFY(id < edges_.size() && edges_[id] != EdgeId());
+                edges[i] = edges_[id];
+                ranges[i] = MappingRange(is, is + il, ms, ms + ml);
+            }
+            path = Path(edges, ranges);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Stores the paths of the batch of reads. Safe to be called concurrently.
+     */
+    void Store(size_t stream, size_t start, uint64_t reads_hash, const std::vector<Path> &paths) {
+        if (replay_ || broken_)
+            return;
+
+        std::vector<uint8_t> data;
+        for (const auto &path : paths) {
+            mapping_cache::PutVarint(data, path.size());
+            for (size_t i = 0; i < path.size(); ++i) {
+                MappingRange range = path.mapping_at(i);
+                mapping_cache::PutVarint(data, g_.int_id(path.edge_at(i)));
+                mapping_cache::PutVarint(data, range.initial_range.start_pos);
+                mapping_cache::PutVarint(data, range.initial_range.size());
+                mapping_cache::PutVarint(data, range.mapped_range.start_pos);
+                mapping_cache::PutVarint(data, range.mapped_range.size());
+            }
+        }
+
+        BatchHeader batch = { stream, start, reads_hash, paths.size(), data.size() };
+        std::lock_guard<std::mutex> guard(lock_);
+        if (fwrite(&batch, sizeof(batch), 1, out_) != 1 ||
+            fwrite(data.data(), 1, data.size(), out_) != data.size()) {
+            WARN("Failed to write mapping cache " << tmp_file() << ", mappings will not be cached");
+            broken_ = true;
+        }
+    }
+
+    /**
+     * @brief Drops the cache being written, e.g. if not all the reads were mapped.
+     */
+    void Discard() {
+        if (!replay_)
+            broken_ = true;
+    }
+
+    /**
+     * @brief Publishes the completely written cache, removes the broken one.
+     */
+    void Finish() {
+        if (replay_) {
+            reader_ = MMappedReader();
+            if (broken_)
+                fs::remove_if_exists(file_name_);
+            replay_ = false;
+            return;
+        }
+
+        if (!out_)
+            return;
+
+        bool ok = (fclose(out_) == 0) && !broken_;
+        out_ = nullptr;
+        if (ok && rename(tmp_file().c_str(), file_name_.c_str()) == 0)
+            return;
+        fs::remove_if_exists(tmp_file());
+    }
+
+private:
+    DECL_LOGGER("MappingCache");
+};
+
+}
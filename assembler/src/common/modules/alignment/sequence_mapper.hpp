@@ -291,9 +291,71 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
   size_t k_;
   bool optimization_on_;
 
-  bool FindKmer(const Kmer &kmer, size_t kmer_pos, std::vector<EdgeId> &passed,
+  typedef typename Index::KeyWithHash KeyWithHash;
+
+  // K-mers which could not be threaded through the graph have to be looked up
+  // in the index. Such k-mers usually come in runs (e.g. all the k-mers covering
+  // a sequencing error), so the lookups of the following k-mers of the read are
+  // issued ahead: their hashes are computed and the index entries are prefetched
+  // in a batch, overlapping the memory accesses. The batch grows while the
+  // lookups go in a row and drops to a single k-mer otherwise.
+  class KmerLookahead {
+      static const size_t MaxBatch = 16;
+
+      const Index &index_;
+      const Sequence &sequence_;
+      size_t k_;
+      std::vector<KeyWithHash> batch_;
+      // Holds the last substituted k-mer, so Get could return a reference
+      std::vector<KeyWithHash> substituted_;
+      size_t start_;
+      size_t last_;
+      size_t batch_size_;
+
+  public:
+      KmerLookahead(const Index &index, const Sequence &sequence, size_t k)
+              : index_(index), sequence_(sequence), k_(k),
+                start_(0), last_(-1ull), batch_size_(1) {
+          batch_.reserve(MaxBatch);
+          substituted_.reserve(1);
+      }
+
+      // kmer is the k-mer of the read at position pos, lookup is the one to be found in the index.
+      // The reference is valid until the next call.
+      const KeyWithHash &Get(const Kmer &kmer, const Kmer &lookup, size_t pos) {
+          bool in_row = (pos == last_ + 1);
+          last_ = pos;
+          // Substituted k-mers are not the ones of the read
+          if (lookup != kmer) {
+              substituted_.clear();
+              substituted_.push_back(index_.ConstructKWH(lookup));
+              return substituted_.back();
+          }
+
+          if (pos >= start_ && pos - start_ < batch_.size())
+              return batch_[pos - start_];
+
+          batch_size_ = in_row ? std::min(2 * batch_size_, MaxBatch) : 1;
+          batch_.clear();
+          start_ = pos;
+          Kmer next = kmer;
+          for (size_t i = 0; i < batch_size_; ++i) {
+              if (i > 0) {
+                  if (pos + i + k_ > sequence_.size())
+                      break;
+                  next <<= sequence_[pos + i + k_ - 1];
+              }
+              batch_.push_back(index_.ConstructKWH(next));
+              index_.Prefetch(batch_.back());
+          }
+
+          return batch_.front();
+      }
+  };
+
+  bool FindKmer(const KeyWithHash &kwh, size_t kmer_pos, std::vector<EdgeId> &passed,
                 RangeMappings& range_mappings) const {
-    std::pair<EdgeId, size_t> position = index_.get(kmer);
+    std::pair<EdgeId, size_t> position = index_.get(kwh);
     if (position.second == -1u)
         return false;
     
@@ -344,10 +406,11 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
   }
 
   bool ProcessKmer(const Kmer &kmer, size_t kmer_pos, std::vector<EdgeId> &passed_edges,
-                   RangeMappings& range_mapping, bool try_thread) const {
+                   RangeMappings& range_mapping, bool try_thread, KmerLookahead &lookahead) const {
     if (try_thread) {
         if (!TryThread(kmer, kmer_pos, passed_edges, range_mapping)) {
-            FindKmer(kmer_mapper_.Substitute(kmer), kmer_pos, passed_edges, range_mapping);
+            FindKmer(lookahead.Get(kmer, kmer_mapper_.Substitute(kmer), kmer_pos),
+                     kmer_pos, passed_edges, range_mapping);
             return false;
         }
 
@@ -355,11 +418,12 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
     }
 
     if (kmer_mapper_.CanSubstitute(kmer)) {
-        FindKmer(kmer_mapper_.Substitute(kmer), kmer_pos, passed_edges, range_mapping);
+        FindKmer(lookahead.Get(kmer, kmer_mapper_.Substitute(kmer), kmer_pos),
+                 kmer_pos, passed_edges, range_mapping);
         return false;
     }
 
-    return FindKmer(kmer, kmer_pos, passed_edges, range_mapping);
+    return FindKmer(lookahead.Get(kmer, kmer, kmer_pos), kmer_pos, passed_edges, range_mapping);
   }
 
  public:
@@ -379,14 +443,15 @@ class BasicSequenceMapper: public AbstractSequenceMapper<Graph> {
       return MappingPath<EdgeId>();
     }
 
+    KmerLookahead lookahead(index_, sequence, k_);
     Kmer kmer = sequence.start<Kmer>(k_);
     bool try_thread = false;
     try_thread = ProcessKmer(kmer, 0, passed_edges,
-                             range_mapping, try_thread);
+                             range_mapping, try_thread, lookahead);
     for (size_t i = k_; i < sequence.size(); ++i) {
       kmer <<= sequence[i];
       try_thread = ProcessKmer(kmer, i - k_ + 1, passed_edges,
-                               range_mapping, try_thread);
+                               range_mapping, try_thread, lookahead);
     }
 
     return MappingPath<EdgeId>(passed_edges, range_mapping);
@@ -9,12 +9,19 @@
 #define SEQUENCE_MAPPER_NOTIFIER_HPP_
 
 #include "sequence_mapper.hpp"
+#include "mapping_cache.hpp"
 #include "io/reads/paired_read.hpp"
 #include "io/reads/read_stream_vector.hpp"
+#include "io/reads/binary_streams.hpp"
 #include "pipeline/graph_pack.hpp"
 #include "common/utils/memory_limit.hpp"
+#include "utils/parallel/openmp_wrapper.h"
 
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
 #include <cstdlib>
 
 namespace debruijn_graph {
@@ -33,62 +40,163 @@ public:
     virtual void ProcessSingleRead(size_t /* thread_index */, const io::SingleReadSeq& /* r */, const MappingPath<EdgeId>& /* read */) {}
 
     virtual void MergeBuffer(size_t /* thread_index */) {}
+
+    // Listener got enough reads, checked after merging the buffers. The library
+    // processing stops early once all its listeners are saturated.
+    virtual bool Saturated() const { return false; }
     
     virtual ~SequenceMapperListener() {}
 };
 
+/**
+ * @brief Hands out batches of consecutive reads from any of the streams, so the number
+ *        of the worker threads is not limited by the number of streams. Every thread
+ *        starts with its own stream and takes over the others when it is exhausted or busy.
+ */
+template<class ReadType>
+class ReadBatchDispatcher {
+    struct StreamState {
+        std::mutex lock;
+        size_t position = 0;
+        std::atomic<bool> exhausted{false};
+    };
+
+    io::ReadStreamList<ReadType>& streams_;
+    std::vector<StreamState> states_;
+    std::atomic<size_t> active_;
+
+public:
+    explicit ReadBatchDispatcher(io::ReadStreamList<ReadType>& streams)
+            : streams_(streams), states_(streams.size()), active_(streams.size()) {}
+
+    /**
+     * @brief Reads up to max_size reads into the batch and reports the stream they
+     *        were taken from and the index of the first one inside the stream.
+     *        Returns false when all the streams are exhausted.
+     */
+    bool Next(size_t ithread, size_t max_size,
+              std::vector<ReadType>& reads, size_t& stream, size_t& start) {
+        size_t n = states_.size();
+        // The first pass skips the streams busy with other threads, the later ones wait for them
+        for (bool wait = false; active_ > 0; wait = true) {
+            for (size_t j = 0; j < n; ++j) {
+                size_t s = (ithread + j) % n;
+                StreamState& state = states_[s];
+                if (state.exhausted)
+                    continue;
+
+                std::unique_lock<std::mutex> lock(state.lock, std::defer_lock);
+                if (wait)
+                    lock.lock();
+                else if (!lock.try_lock())
+                    continue;
+
+                auto& is = streams_[s];
+                // Binary streams decode the whole batch at once
+                if (auto binary = dynamic_cast<io::MappedBinaryStream<ReadType>*>(&is)) {
+                    binary->ReadBatch(reads, max_size);
+                } else {
+                    reads.clear();
+                    while (!is.eof() && reads.size() < max_size) {
+                        reads.emplace_back();
+                        is >> reads.back();
+                    }
+                }
+                stream = s;
+                start = state.position;
+                state.position += reads.size();
+
+                if (is.eof() && !state.exhausted) {
+                    state.exhausted = true;
+                    active_ -= 1;
+                }
+                if (!reads.empty())
+                    return true;
+            }
+        }
+
+        return false;
+    }
+};
+
 class SequenceMapperNotifier {
     static constexpr size_t BUFFER_SIZE = 200000;
+    // Reads are mapped (and cached) by batches of this size
+    static constexpr size_t BATCH_SIZE = 4096;
 public:
     typedef SequenceMapper<conj_graph_pack::graph_t> SequenceMapperT;
 
     typedef std::vector<SequenceMapperListener*> ListenersContainer;
 
-    SequenceMapperNotifier(const conj_graph_pack& gp, size_t lib_count)
-            : gp_(gp), listeners_(lib_count) { }
+    // buffer_size is the number of reads each thread collects before merging them
+    SequenceMapperNotifier(const conj_graph_pack& gp, size_t lib_count, size_t buffer_size = BUFFER_SIZE)
+            : gp_(gp), buffer_size_(buffer_size), replayed_reads_(0), listeners_(lib_count) { }
 
     void Subscribe(size_t lib_index, SequenceMapperListener* listener) {
         VERIFY(lib_index < listeners_.size());
         listeners_[lib_index].push_back(listener);
     }
 
+    // Returns true if the processing stopped early because all the listeners were saturated
     template<class ReadType>
-    void ProcessLibrary(io::ReadStreamList<ReadType>& streams,
+    bool ProcessLibrary(io::ReadStreamList<ReadType>& streams,
                         size_t lib_index, const SequenceMapperT& mapper, size_t threads_count = 0) {
         if (threads_count == 0)
-            threads_count = streams.size();
+            threads_count = omp_get_max_threads();
 
         streams.reset();
         NotifyStartProcessLibrary(lib_index, threads_count);
         size_t counter = 0, n = 15;
         size_t fmem = utils::get_free_memory();
+        auto cache = OpenMappingCache<ReadType>(streams, lib_index, mapper);
+        ReadBatchDispatcher<ReadType> dispatcher(streams);
+        std::mutex merge_lock;
+        std::atomic<bool> saturated(false);
+        std::atomic<size_t> replayed(0);
 
-        #pragma omp parallel for num_threads(threads_count) shared(counter)
-        for (size_t i = 0; i < streams.size(); ++i) {
-            size_t size = 0;
-            ReadType r;
-            auto& stream = streams[i];
-            while (!stream.eof()) {
-                if (size == BUFFER_SIZE || 
-                    // Stop filling buffer if the amount of available is smaller
-                    // than half of free memory.
-                    (10 * utils::get_free_memory() / 4 < fmem && size > 10000)) {
-                    #pragma omp critical
-                    {
-                        counter += size;
-                        if (counter >> n) {
-                            INFO("Processed " << counter << " reads");
-                            n += 1;
-                        }
-                        size = 0;
-                        NotifyMergeBuffer(lib_index, i);
-                    }
+        #pragma omp parallel num_threads(threads_count)
+        {
+            size_t ithread = omp_get_thread_num();
+            size_t size = 0, stream, start;
+            std::vector<ReadType> reads;
+            std::vector<MappingPath<EdgeId>> paths;
+            while (!saturated && dispatcher.Next(ithread, BATCH_SIZE, reads, stream, start)) {
+                if (MapBatch(reads, mapper, cache.get(), stream, start, paths))
+                    replayed += reads.size();
+
+                auto path = paths.cbegin();
+                for (const auto& r : reads)
+                    NotifyProcessRead(r, path, lib_index, ithread);
+                size += reads.size();
+
+                // Stop filling buffer if the amount of available is smaller
+                // than half of free memory.
+                bool low_memory = (10 * utils::get_free_memory() / 4 < fmem && size > 10000);
+                if (size < buffer_size_ && !low_memory)
+                    continue;
+
+                // Merge only if no other thread is merging now, otherwise keep on filling
+                // the buffer. Wait for the merge only if the buffer became too large.
+                std::unique_lock<std::mutex> lock(merge_lock, std::defer_lock);
+                if (low_memory || size >= 2 * buffer_size_)
+                    lock.lock();
+                else if (!lock.try_lock())
+                    continue;
+
+                counter += size;
+                if (counter >> n) {
+                    INFO("Processed " << counter << " reads");
+                    n += 1;
+                }
+                size = 0;
+                NotifyMergeBuffer(lib_index, ithread);
+                if (!saturated && Saturated(lib_index)) {
+                    INFO("Enough reads processed, skipping the rest of the library");
+                    saturated = true;
                 }
-                stream >> r;
-                ++size;
-                NotifyProcessRead(r, mapper, lib_index, i);
             }
-            #pragma omp atomic
+
+            std::lock_guard<std::mutex> lock(merge_lock);
             counter += size;
         }
 
@@ -96,18 +204,88 @@ public:
             NotifyMergeBuffer(lib_index, i);
 
         INFO("Total " << counter << " reads processed");
+        replayed_reads_ = replayed;
+        if (replayed_reads_)
+            INFO("Mappings of " << replayed_reads_ << " reads were taken from the cache");
+        // Do not keep the mappings of the incomplete pass
+        if (cache && saturated)
+            cache->Discard();
         NotifyStopProcessLibrary(lib_index);
+        return saturated;
+    }
+
+    // Number of reads of the last processed library with the mappings replayed from the cache
+    size_t replayed_reads() const {
+        return replayed_reads_;
     }
 
 private:
+    typedef MappingCache<conj_graph_pack::graph_t> MappingCacheT;
+    typedef std::vector<MappingPath<EdgeId>>::const_iterator PathIterator;
+
+    // Opens per-library cache keyed by the graph, the mapper and the reads, if caching is enabled
+    template<class ReadType>
+    std::unique_ptr<MappingCacheT> OpenMappingCache(const io::ReadStreamList<ReadType>& streams,
+                                                    size_t ilib, const SequenceMapperT& mapper) const {
+        if (gp_.mapping_cache_dir.empty())
+            return nullptr;
+
+        uint64_t kind = mapping_cache::Hash(std::string(typeid(mapper).name()),
+                                            mapping_cache::Hash(std::string(typeid(ReadType).name())));
+        // Both content hashes are maintained on the modifications, so no need to walk the graph here
+        uint64_t key = mapping_cache::Mix(gp_.content_hash.hash(), kind);
+        key = mapping_cache::Mix(key, streams.size());
+        key = mapping_cache::Mix(key, gp_.kmer_mapper.content_hash());
+
+        std::string file = fs::append_path(gp_.mapping_cache_dir,
+                                           fmt::format("lib{:d}_{:016x}.map", ilib, kind));
+        return std::unique_ptr<MappingCacheT>(new MappingCacheT(gp_.g, file, key));
+    }
+
+    // Returns true if the paths were taken from the cache
+    template<class ReadType>
+    bool MapBatch(const std::vector<ReadType>& reads, const SequenceMapperT& mapper, MappingCacheT* cache,
+                  size_t stream, size_t start, std::vector<MappingPath<EdgeId>>& paths) const {
+        uint64_t reads_hash = 0;
+        if (cache) {
+            for (const auto& r : reads)
+                reads_hash = ReadHash(r, reads_hash);
+            if (cache->Fetch(stream, start, reads_hash, paths))
+                return true;
+        }
+
+        paths.clear();
+        for (const auto& r : reads)
+            MapRead(r, mapper, paths);
+
+        if (cache)
+            cache->Store(stream, start, reads_hash, paths);
+        return false;
+    }
+
+    template<class ReadType>
+    static uint64_t ReadHash(const ReadType& r, uint64_t h);
+
     template<class ReadType>
-    void NotifyProcessRead(const ReadType& r, const SequenceMapperT& mapper, size_t ilib, size_t ithread) const;
+    static void MapRead(const ReadType& r, const SequenceMapperT& mapper, std::vector<MappingPath<EdgeId>>& paths);
+
+    template<class ReadType>
+    void NotifyProcessRead(const ReadType& r, PathIterator& path, size_t ilib, size_t ithread) const;
 
     void NotifyStartProcessLibrary(size_t ilib, size_t thread_count) const {
         for (const auto& listener : listeners_[ilib])
             listener->StartProcessLibrary(thread_count);
     }
 
+    bool Saturated(size_t ilib) const {
+        if (listeners_[ilib].empty())
+            return false;
+        for (const auto& listener : listeners_[ilib])
+            if (!listener->Saturated())
+                return false;
+        return true;
+    }
+
     void NotifyStopProcessLibrary(size_t ilib) const {
         for (const auto& listener : listeners_[ilib])
             listener->StopProcessLibrary();
@@ -118,20 +296,69 @@ private:
             listener->MergeBuffer(ithread);
     }
     const conj_graph_pack& gp_;
+    size_t buffer_size_;
+    size_t replayed_reads_;
 
     std::vector<std::vector<SequenceMapperListener*> > listeners_;  //first vector's size = count libs
 };
 
+template<>
+inline uint64_t SequenceMapperNotifier::ReadHash(const io::PairedReadSeq& r, uint64_t h) {
+    return mapping_cache::Hash(r.second().sequence(), mapping_cache::Hash(r.first().sequence(), h));
+}
+
+template<>
+inline uint64_t SequenceMapperNotifier::ReadHash(const io::PairedRead& r, uint64_t h) {
+    return mapping_cache::Hash(r.second().GetSequenceString(), mapping_cache::Hash(r.first().GetSequenceString(), h));
+}
+
+template<>
+inline uint64_t SequenceMapperNotifier::ReadHash(const io::SingleReadSeq& r, uint64_t h) {
+    return mapping_cache::Hash(r.sequence(), h);
+}
+
+template<>
+inline uint64_t SequenceMapperNotifier::ReadHash(const io::SingleRead& r, uint64_t h) {
+    return mapping_cache::Hash(r.GetSequenceString(), h);
+}
+
+template<>
+inline void SequenceMapperNotifier::MapRead(const io::PairedReadSeq& r,
+                                            const SequenceMapperT& mapper,
+                                            std::vector<MappingPath<EdgeId>>& paths) {
+    paths.push_back(mapper.MapSequence(r.first().sequence()));
+    paths.push_back(mapper.MapSequence(r.second().sequence()));
+}
+
+template<>
+inline void SequenceMapperNotifier::MapRead(const io::PairedRead& r,
+                                            const SequenceMapperT& mapper,
+                                            std::vector<MappingPath<EdgeId>>& paths) {
+    paths.push_back(mapper.MapRead(r.first()));
+    paths.push_back(mapper.MapRead(r.second()));
+}
+
+template<>
+inline void SequenceMapperNotifier::MapRead(const io::SingleReadSeq& r,
+                                            const SequenceMapperT& mapper,
+                                            std::vector<MappingPath<EdgeId>>& paths) {
+    paths.push_back(mapper.MapSequence(r.sequence()));
+}
+
+template<>
+inline void SequenceMapperNotifier::MapRead(const io::SingleRead& r,
+                                            const SequenceMapperT& mapper,
+                                            std::vector<MappingPath<EdgeId>>& paths) {
+    paths.push_back(mapper.MapRead(r));
+}
+
 template<>
 inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r,
-                                                      const SequenceMapperT& mapper,
+                                                      PathIterator& path,
                                                       size_t ilib,
                                                       size_t ithread) const {
-
-    const Sequence& read1 = r.first().sequence();
-    const Sequence& read2 = r.second().sequence();
-    MappingPath<EdgeId> path1 = mapper.MapSequence(read1);
-    MappingPath<EdgeId> path2 = mapper.MapSequence(read2);
+    const MappingPath<EdgeId>& path1 = *path++;
+    const MappingPath<EdgeId>& path2 = *path++;
     for (const auto& listener : listeners_[ilib]) {
         listener->ProcessPairedRead(ithread, r, path1, path2);
         listener->ProcessSingleRead(ithread, r.first(), path1);
@@ -141,11 +368,11 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r
 
 template<>
 inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
-                                                      const SequenceMapperT& mapper,
+                                                      PathIterator& path,
                                                       size_t ilib,
                                                       size_t ithread) const {
-    MappingPath<EdgeId> path1 = mapper.MapRead(r.first());
-    MappingPath<EdgeId> path2 = mapper.MapRead(r.second());
+    const MappingPath<EdgeId>& path1 = *path++;
+    const MappingPath<EdgeId>& path2 = *path++;
     for (const auto& listener : listeners_[ilib]) {
         listener->ProcessPairedRead(ithread, r, path1, path2);
         listener->ProcessSingleRead(ithread, r.first(), path1);
@@ -155,23 +382,22 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
 
 template<>
 inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleReadSeq& r,
-                                                      const SequenceMapperT& mapper,
+                                                      PathIterator& path,
                                                       size_t ilib,
                                                       size_t ithread) const {
-    const Sequence& read = r.sequence();
-    MappingPath<EdgeId> path = mapper.MapSequence(read);
+    const MappingPath<EdgeId>& read_path = *path++;
     for (const auto& listener : listeners_[ilib])
-        listener->ProcessSingleRead(ithread, r, path);
+        listener->ProcessSingleRead(ithread, r, read_path);
 }
 
 template<>
 inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleRead& r,
-                                                      const SequenceMapperT& mapper,
+                                                      PathIterator& path,
                                                       size_t ilib,
                                                       size_t ithread) const {
-    MappingPath<EdgeId> path = mapper.MapRead(r);
+    const MappingPath<EdgeId>& read_path = *path++;
     for (const auto& listener : listeners_[ilib])
-        listener->ProcessSingleRead(ithread, r, path);
+        listener->ProcessSingleRead(ithread, r, read_path);
 }
 
 } /*debruijn_graph*/
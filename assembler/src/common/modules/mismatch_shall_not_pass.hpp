@@ -276,6 +276,8 @@ private:
                 conjugate_fix.insert(*it);
             }
         }
+        //index is not used during the correction, so it is updated at once in the end
+        typename Graph::BatchScope batch(g_);
         for (auto it = conjugate_fix.begin(); it != conjugate_fix.end(); ++it) {
             EdgeId e = *it;
             DEBUG("processing edge" << g_.int_id(e));
@@ -17,53 +17,134 @@
 #include <vector>
 #include "pipeline/graph_pack.hpp"
 
+#include <cuckoo/cuckoohash_map.hh>
+
 namespace path_extend {
 
 using debruijn_graph::Graph;
 using debruijn_graph::EdgeId;
 
+/**
+ * @brief Counts the expected paired info between two edges. Insert size distribution is kept
+ *        as the prefix sums of the probabilities and of the first moments over the dense
+ *        insert size range, thus the (non-additive) weight is a sum of a few linear pieces
+ *        and is computed in O(1). Additive weights are not linear in the insert size, so they
+ *        are computed once and cached in the concurrent hash table.
+ */
 class IdealPairInfoCounter {
+    struct CacheKey {
+        size_t len1;
+        size_t len2;
+        int dist;
+
+        bool operator==(const CacheKey &other) const {
+            return len1 == other.len1 && len2 == other.len2 && dist == other.dist;
+        }
+    };
+
+    struct CacheKeyHash {
+        size_t operator()(const CacheKey &key) const {
+            size_t h = std::hash<size_t>()(key.len1);
+            h ^= std::hash<size_t>()(key.len2) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            h ^= std::hash<int>()(key.dist) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
 public:
     IdealPairInfoCounter(const Graph& g, int d_min, int d_max, size_t read_size,
                          const std::map<int, size_t>& is_distribution)
             : g_(g),
               d_min_(d_min),
               d_max_(d_max),
-              read_size_(read_size) {
+              read_size_(read_size),
+              is_min_(0) {
         size_t sum = 0;
         for (auto iter = is_distribution.begin(); iter != is_distribution.end();
                 ++iter) {
             sum += iter->second;
         }
-        for (auto iter = is_distribution.begin(); iter != is_distribution.end();
-                ++iter) {
-            insert_size_distrib_[iter->first] = (double) iter->second
-                    / (double) sum;
-        }
+        PreCalculateDistribution(is_distribution, sum);
         PreCalculateNotTotalReadsWeight();
     }
 
     double IdealPairedInfo(EdgeId e1, EdgeId e2, int dist, bool additive = false) const {
-        std::pair<size_t, size_t> lengths = make_pair(g_.length(e1), g_.length(e2));
-        if (pi_.find(lengths) == pi_.end()) {
-            pi_.insert(make_pair(lengths, std::map<int, double>()));
+        return IdealPairedInfo(g_.length(e1), g_.length(e2), dist, additive);
+    }
+
+    double IdealPairedInfo(size_t len1, size_t len2, int dist, bool additive = false) const {
+        if (!additive)
+            return LinearPairedInfo(len1, len2, dist);
+
+        CacheKey key = {len1, len2, dist};
+        double result;
+        if (additive_cache_.find(key, result))
+            return result;
+        result = AdditivePairedInfo(len1, len2, dist);
+        additive_cache_.insert(key, result);
+        return result;
+    }
+
+private:
+    //Sum of p(is) * (slope * is + shift) over is in [left, right]
+    double SumLinear(long long left, long long right, long long slope, long long shift) const {
+        left = std::max(left, is_min_);
+        right = std::min(right, is_min_ + (long long) probs_.size() - 1);
+        if (left > right)
+            return 0.0;
+        size_t l = size_t(left - is_min_), r = size_t(right - is_min_) + 1;
+        return (double) slope * (moment_prefix_[r] - moment_prefix_[l]) +
+               (double) shift * (prob_prefix_[r] - prob_prefix_[l]);
+    }
+
+    //Sum of p(is) * IdealReads(len1, len2, dist, is, false)
+    double LinearPairedInfo(size_t len1_1, size_t len2_1, int dist) const {
+        long long len1 = (long long) len1_1;
+        long long len2 = (long long) len2_1;
+        long long k = (long long) g_.k();
+        long long rs = (long long) read_size_;
+        if (dist == 0) {
+            return SumLinear(is_min_, std::numeric_limits<int>::max(), -1, len1 + 2 * rs - 2 - k + 1);
         }
-        std::map<int, double>& weights = pi_[lengths];
-        if (weights.find(dist) == weights.end()) {
-            weights.insert(make_pair(dist, IdealPairedInfo(g_.length(e1), g_.length(e2), dist, additive)));
+        if (dist < 0) {
+            std::swap(len1, len2);
+            dist = -dist;
         }
-        return weights[dist];
+
+        //Number of the reads is min(right_long, right_short) - max(left_short, left_long) + 1 (see IdealReads),
+        //where right_long and left_long grow with the insert size, i.e. it is min(is + a, c, b - is)
+        long long gap_len = dist - len1;
+        long long right_short = gap_len + len2 - 1;
+        long long left_short = gap_len + k + 1 - rs;
+        long long right_long_shift = -rs - 1;
+        long long left_long_shift = -rs - len1 - rs + (k + 1);
+
+        long long a = right_long_shift - left_short + 1;
+        long long c = std::min(right_long_shift - left_long_shift + 1, right_short - left_short + 1);
+        long long b = right_short - left_long_shift + 1;
+        if (c <= 0)
+            return 0.0;
+
+        //Last insert size where the rising piece is the minimum
+        long long rising_end = std::min(c - a, FloorDiv(b - a, 2));
+        double result = SumLinear(1 - a, rising_end, 1, a);
+        result += SumLinear(rising_end + 1, b - c - 1, 0, c);
+        result += SumLinear(std::max(rising_end + 1, b - c), b - 1, -1, b);
+        return result;
     }
 
-    double IdealPairedInfo(size_t len1, size_t len2, int dist, bool additive = false) const {
+    double AdditivePairedInfo(size_t len1, size_t len2, int dist) const {
         double result = 0.0;
-        for (auto it = insert_size_distrib_.lower_bound(max(d_min_, 0)); it != insert_size_distrib_.upper_bound(d_max_); ++it) {
-            result += it->second * (double) IdealReads(len1, len2, dist, it->first, additive);
+        for (size_t i = 0; i < probs_.size(); ++i) {
+            if (probs_[i] > 0.0)
+                result += probs_[i] * (double) IdealReads(len1, len2, dist, size_t(is_min_) + i, true);
         }
         return result;
     }
 
-private:
+    static long long FloorDiv(long long a, long long b) {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+    }
 
     double IdealReads(size_t len1_1, size_t len2_1, int dist,
                       size_t is_1, bool additive) const {
@@ -101,6 +182,25 @@ private:
         return w > 0.0 ? w : 0.0;
     }
 
+    //Dense probabilities over [max(d_min, 0), d_max] with their prefix sums
+    void PreCalculateDistribution(const std::map<int, size_t>& is_distribution, size_t sum) {
+        auto begin = is_distribution.lower_bound(max(d_min_, 0));
+        auto end = is_distribution.upper_bound(d_max_);
+        if (begin != end) {
+            is_min_ = begin->first;
+            probs_.resize(size_t(std::prev(end)->first - begin->first + 1), 0.0);
+            for (auto it = begin; it != end; ++it)
+                probs_[size_t(it->first - is_min_)] = (double) it->second / (double) sum;
+        }
+
+        prob_prefix_.push_back(0.0);
+        moment_prefix_.push_back(0.0);
+        for (size_t i = 0; i < probs_.size(); ++i) {
+            prob_prefix_.push_back(prob_prefix_.back() + probs_[i]);
+            moment_prefix_.push_back(moment_prefix_.back() + probs_[i] * (double) (is_min_ + (long long) i));
+        }
+    }
+
     void PreCalculateNotTotalReadsWeight() {
         not_total_weights_right_.push_back(0.0);
         not_total_weights_left_.push_back(0.0);
@@ -116,9 +216,11 @@ private:
     int d_min_;
     int d_max_;
     size_t read_size_;
-    std::vector<double> weights_;
-    std::map<int, double> insert_size_distrib_;
-    mutable std::map<std::pair<size_t, size_t>, std::map<int, double> > pi_;
+    long long is_min_;
+    std::vector<double> probs_;
+    std::vector<double> prob_prefix_;
+    std::vector<double> moment_prefix_;
+    mutable cuckoohash_map<CacheKey, double, CacheKeyHash> additive_cache_;
     std::vector<double> not_total_weights_right_;
     std::vector<double> not_total_weights_left_;
 protected:
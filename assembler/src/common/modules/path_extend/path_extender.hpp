@@ -19,7 +19,11 @@
 #include "path_filter.hpp"
 #include "overlap_analysis.hpp"
 #include "assembly_graph/graph_support/scaff_supplementary.hpp"
+#include "utils/parallel/openmp_wrapper.h"
 #include <cmath>
+#include <functional>
+#include <memory>
+#include <unordered_set>
 
 namespace path_extend {
 
@@ -195,7 +199,8 @@ public:
                 break;
             EdgeId e = path.At(i);
             if (g_.length(e) >= min_edge_len_) {
-                utils::insert_all(candidates, coverage_map_.GetCoveringPaths(e));
+                for (const auto &entry : coverage_map_.GetEdgePaths(e)->paths())
+                    candidates.insert(entry.first);
                 cum_len += path.ShiftLength(i);
             }
         }
@@ -817,9 +822,16 @@ public:
         BidirectionalPath * cp = new BidirectionalPath(p->Conjugate());
         visited_cycles_coverage_map_.Subscribe(p);
         visited_cycles_coverage_map_.Subscribe(cp);
+        path_storage_.AddPair(p, cp);
         DEBUG("add cycle");
         p->PrintDEBUG();
     }
+
+    //Forgets the cycles visited so far
+    void Clear() {
+        visited_cycles_coverage_map_.Clear();
+        path_storage_.DeleteAllPaths();
+    }
 };
 
 class PathExtender {
@@ -831,6 +843,9 @@ public:
 
     virtual bool MakeGrowStep(BidirectionalPath& path, PathContainer* paths_storage = nullptr) = 0;
 
+    //Drops the state accumulated while growing the previous paths
+    virtual void Reset() { }
+
 protected:
     const Graph &g_;
     DECL_LOGGER("PathExtender")
@@ -838,6 +853,9 @@ protected:
 
 class CompositeExtender {
 public:
+    //Makes the extenders working with the given coverage map and used edges storage
+    typedef std::function<vector<shared_ptr<PathExtender>>(const GraphCoverageMap&,
+                                                           UsedUniqueStorage&)> ExtendersFactory;
 
     CompositeExtender(const Graph &g, GraphCoverageMap& cov_map,
                       UsedUniqueStorage &unique,
@@ -845,86 +863,231 @@ public:
             : g_(g),
               cover_map_(cov_map),
               used_storage_(unique),
-              extenders_(pes) {}
+              extenders_(pes),
+              batch_size_(0) {}
+
+    /*
+     * Seeds are grown speculatively in parallel in batches of batch_size, every thread
+     * uses its own extenders (made by the factory) working with the overlays of the
+     * coverage map and used edges storage. The results are committed in the order of seeds;
+     * a seed is grown once again if anything it has looked up was changed by the preceding
+     * seeds of the batch. So the result does not depend on the number of threads and differs
+     * from the sequential one only in that the extenders state (e.g. the visited
+     * insert-size cycles) is reset before every seed.
+     */
+    void EnableParallelGrowth(const ExtendersFactory &factory, size_t batch_size = 1000) {
+        VERIFY(batch_size > 0);
+        factory_ = factory;
+        batch_size_ = batch_size;
+    }
 
     void GrowAll(PathContainer& paths, PathContainer& result) {
         result.clear();
-        GrowAllPaths(paths, result);
+        if (batch_size_ > 0)
+            GrowAllPathsParallel(paths, result);
+        else
+            GrowAllPaths(paths, result);
         result.FilterEmptyPaths();
     }
 
     void GrowPath(BidirectionalPath& path, PathContainer* paths_storage) {
-        while (MakeGrowStep(path, paths_storage)) { }
+        GrowPath(path, paths_storage, extenders_);
     }
 
 
 private:
+    typedef vector<shared_ptr<PathExtender>> Extenders;
+
+    struct Workspace {
+        std::vector<EdgeId> footprint;
+        GraphCoverageMap cover_map;
+        UsedUniqueStorage used_storage;
+        Extenders extenders;
+
+        Workspace(const GraphCoverageMap &base_cover_map, const UsedUniqueStorage &base_used_storage,
+                  const ExtendersFactory &factory)
+                : cover_map(base_cover_map, &footprint),
+                  used_storage(base_used_storage, &footprint),
+                  extenders(factory(cover_map, used_storage)) {}
+
+        void Reset() {
+            footprint.clear();
+            cover_map.Clear();
+            used_storage.clear();
+            for (auto &extender : extenders)
+                extender->Reset();
+        }
+    };
+
+    struct SeedResult {
+        PathContainer paths;
+        //The number of leading path pairs tracked by the coverage map
+        size_t subscribed;
+        std::vector<EdgeId> footprint;
+        std::vector<EdgeId> used;
+
+        SeedResult() : subscribed(0) {}
+    };
+
     const Graph &g_;
     GraphCoverageMap &cover_map_;
     UsedUniqueStorage &used_storage_;
-    vector<shared_ptr<PathExtender>> extenders_;
+    Extenders extenders_;
+    ExtendersFactory factory_;
+    size_t batch_size_;
+    std::vector<std::unique_ptr<Workspace>> workspaces_;
 
-    bool MakeGrowStep(BidirectionalPath& path, PathContainer* paths_storage) {
+    bool MakeGrowStep(BidirectionalPath& path, PathContainer* paths_storage, const Extenders &extenders) {
         DEBUG("make grow step composite extender");
 
         size_t current = 0;
-        while (current < extenders_.size()) {
-            DEBUG("step " << current << " of total " << extenders_.size());
-            if (extenders_[current]->MakeGrowStep(path, paths_storage)) {
+        while (current < extenders.size()) {
+            DEBUG("step " << current << " of total " << extenders.size());
+            if (extenders[current]->MakeGrowStep(path, paths_storage)) {
                 return true;
             }
            ++current;
         }
         return false;
     }
-    
-    void GrowAllPaths(PathContainer& paths, PathContainer& result) {
-        for (size_t i = 0; i < paths.size(); ++i) {
-            VERBOSE_POWER_T2(i, 100, "Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
-            if (paths.size() > 10 && i % (paths.size() / 10 + 1) == 0) {
-                INFO("Processed " << i << " paths from " << paths.size() << " (" << i * 100 / paths.size() << "%)");
-            }
-            //In 2015 modes do not use a seed already used in paths.
-            //FIXME what is the logic here?
-            if (used_storage_.UniqueCheckEnabled()) {
-                bool was_used = false;
-                for (size_t ind =0; ind < paths.Get(i)->Size(); ind++) {
-                    EdgeId eid = paths.Get(i)->At(ind);
-                    if (used_storage_.IsUsedAndUnique(eid)) {
-                        DEBUG("Used edge " << g_.int_id(eid));
-                        was_used = true;
-                        break;
-                    } else {
-                        used_storage_.insert(eid);
-                    }
-                }
-                if (was_used) {
-                    DEBUG("skipping already used seed");
-                    continue;
+
+    void GrowPath(BidirectionalPath& path, PathContainer* paths_storage, const Extenders &extenders) {
+        while (MakeGrowStep(path, paths_storage, extenders)) { }
+    }
+
+    void ReportProgress(size_t i, size_t total) const {
+        VERBOSE_POWER_T2(i, 100, "Processed " << i << " paths from " << total << " (" << i * 100 / total << "%)");
+        if (total > 10 && i % (total / 10 + 1) == 0) {
+            INFO("Processed " << i << " paths from " << total << " (" << i * 100 / total << "%)");
+        }
+    }
+
+    //Returns true if the seed was not skipped, i.e. its copy and the path grown from it were added to result
+    bool GrowSeed(const PathContainer& paths, size_t i, PathContainer& result,
+                  GraphCoverageMap &cover_map, UsedUniqueStorage &used_storage,
+                  const Extenders &extenders) {
+        //In 2015 modes do not use a seed already used in paths.
+        //FIXME what is the logic here?
+        if (used_storage.UniqueCheckEnabled()) {
+            bool was_used = false;
+            for (size_t ind =0; ind < paths.Get(i)->Size(); ind++) {
+                EdgeId eid = paths.Get(i)->At(ind);
+                if (used_storage.IsUsedAndUnique(eid)) {
+                    DEBUG("Used edge " << g_.int_id(eid));
+                    was_used = true;
+                    break;
+                } else {
+                    used_storage.insert(eid);
                 }
             }
+            if (was_used) {
+                DEBUG("skipping already used seed");
+                return false;
+            }
+        }
+
+        if (cover_map.IsCovered(*paths.Get(i)))
+            return false;
+
+        AddPath(result, *paths.Get(i), cover_map);
+        BidirectionalPath * path = new BidirectionalPath(*paths.Get(i));
+        BidirectionalPath * conjugatePath = new BidirectionalPath(*paths.GetConjugate(i));
+        SubscribeCoverageMap(path, cover_map);
+        SubscribeCoverageMap(conjugatePath, cover_map);
+        result.AddPair(path, conjugatePath);
+        size_t count_trying = 0;
+        size_t current_path_len = 0;
+        do {
+            current_path_len = path->Length();
+            count_trying++;
+            GrowPath(*path, &result, extenders);
+            GrowPath(*conjugatePath, &result, extenders);
+        } while (count_trying < 10 && (path->Length() != current_path_len));
+        DEBUG("result path " << path->GetId());
+        path->PrintDEBUG();
+        return true;
+    }
 
-            if (!cover_map_.IsCovered(*paths.Get(i))) {
-                AddPath(result, *paths.Get(i), cover_map_);
-                BidirectionalPath * path = new BidirectionalPath(*paths.Get(i));
-                BidirectionalPath * conjugatePath = new BidirectionalPath(*paths.GetConjugate(i));
+    void GrowAllPaths(PathContainer& paths, PathContainer& result) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            ReportProgress(i, paths.size());
+            GrowSeed(paths, i, result, cover_map_, used_storage_, extenders_);
+        }
+    }
+
+    //Grows the seed against the current state of the coverage map and used edges storage
+    void Speculate(Workspace &workspace, const PathContainer& paths, size_t i, SeedResult &res) {
+        workspace.Reset();
+        res.subscribed = GrowSeed(paths, i, res.paths, workspace.cover_map,
+                                  workspace.used_storage, workspace.extenders) ? 2 : 0;
+        res.footprint.swap(workspace.footprint);
+        res.used.assign(workspace.used_storage.used().begin(), workspace.used_storage.used().end());
+    }
+
+    static bool Intersects(const std::vector<EdgeId> &edges, const std::unordered_set<EdgeId> &changed) {
+        if (changed.empty())
+            return false;
+        for (EdgeId e : edges) {
+            if (changed.count(e))
+                return true;
+        }
+        return false;
+    }
+
+    //Applies the speculation result to the main coverage map, used edges storage and result
+    void Commit(SeedResult &res, PathContainer& result, std::unordered_set<EdgeId> &changed) {
+        for (EdgeId e : res.used) {
+            used_storage_.insert(e);
+            changed.insert(e);
+        }
+        for (size_t j = 0; j < res.paths.size(); ++j) {
+            BidirectionalPath * path = new BidirectionalPath(*res.paths.Get(j));
+            BidirectionalPath * conjugatePath = new BidirectionalPath(*res.paths.GetConjugate(j));
+            if (j < res.subscribed) {
                 SubscribeCoverageMap(path, cover_map_);
                 SubscribeCoverageMap(conjugatePath, cover_map_);
-                result.AddPair(path, conjugatePath);
-                size_t count_trying = 0;
-                size_t current_path_len = 0;
-                do {
-                    current_path_len = path->Length();
-                    count_trying++;
-                    GrowPath(*path, &result);
-                    GrowPath(*conjugatePath, &result);
-                } while (count_trying < 10 && (path->Length() != current_path_len));
-                DEBUG("result path " << path->GetId());
-                path->PrintDEBUG();
+                changed.insert(path->begin(), path->end());
+                changed.insert(conjugatePath->begin(), conjugatePath->end());
             }
+            result.AddPair(path, conjugatePath);
         }
+        res.paths.DeleteAllPaths();
     }
 
+    void GrowAllPathsParallel(PathContainer& paths, PathContainer& result) {
+        VERIFY(factory_);
+        size_t nthreads = (size_t) omp_get_max_threads();
+        while (workspaces_.size() < nthreads) {
+            workspaces_.emplace_back(new Workspace(cover_map_, used_storage_, factory_));
+        }
+
+        size_t regrown = 0;
+        std::vector<SeedResult> results;
+        for (size_t start = 0; start < paths.size(); start += batch_size_) {
+            size_t end = std::min(paths.size(), start + batch_size_);
+            results.clear();
+            results.resize(end - start);
+
+            #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+            for (size_t i = start; i < end; ++i) {
+                Speculate(*workspaces_[omp_get_thread_num()], paths, i, results[i - start]);
+            }
+
+            //Edges whose coverage or usage was changed by the seeds committed in this batch
+            std::unordered_set<EdgeId> changed;
+            for (size_t i = start; i < end; ++i) {
+                ReportProgress(i, paths.size());
+                SeedResult &res = results[i - start];
+                if (Intersects(res.footprint, changed)) {
+                    ++regrown;
+                    res.paths.DeleteAllPaths();
+                    Speculate(*workspaces_.front(), paths, i, res);
+                }
+                Commit(res, result, changed);
+            }
+        }
+        INFO("Paths grown in parallel, " << regrown << " of " << paths.size() << " seeds were grown again");
+    }
 };
 
 //All Path-Extenders inherit this one
@@ -1045,6 +1208,10 @@ public:
         return result;
     }
 
+    void Reset() override {
+        is_detector_.Clear();
+    }
+
 private:
     bool ResolveShortLoop(BidirectionalPath& p) {
         if (use_short_loop_cov_resolver_) {
@@ -174,6 +174,9 @@ struct pe_config {
 
         bool use_coordinated_coverage;
 
+        bool parallel_extension;
+        bool compressed_paired_info;
+
         struct CoordinatedCoverageT {
             size_t max_edge_length_in_repeat;
             double delta;
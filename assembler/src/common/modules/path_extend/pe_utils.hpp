@@ -17,6 +17,11 @@
 
 #include "assembly_graph/paths/bidirectional_path.hpp"
 
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <vector>
+
 namespace path_extend {
 
 using namespace debruijn_graph;
@@ -35,35 +40,177 @@ inline bool InTwoEdgeCycle(EdgeId e, const Graph &g) {
     return false;
 }
 
+//Paths covering a single edge with multiplicities, ordered by path id.
+//Behaves like a multiset of paths: every path is iterated as many times as it covers the edge.
+class CoveringPathsMultiset {
+public:
+    typedef std::pair<BidirectionalPath *, size_t> PathCount;
+
+private:
+    //Usually there are only a few paths, so plain sorted vector is faster than any tree
+    std::vector<PathCount> paths_;
+    size_t size_;
+
+    static bool IdLess(const PathCount &entry, const BidirectionalPath *path) {
+        return entry.first->GetId() < path->GetId();
+    }
+
+    std::vector<PathCount>::iterator Find(const BidirectionalPath *path) {
+        return std::lower_bound(paths_.begin(), paths_.end(), path, IdLess);
+    }
+
+    std::vector<PathCount>::const_iterator Find(const BidirectionalPath *path) const {
+        return std::lower_bound(paths_.begin(), paths_.end(), path, IdLess);
+    }
+
+public:
+    class const_iterator : public std::iterator<std::forward_iterator_tag, BidirectionalPath *> {
+        std::vector<PathCount>::const_iterator it_;
+        size_t copy_;
+
+    public:
+        const_iterator(std::vector<PathCount>::const_iterator it) : it_(it), copy_(0) {}
+
+        BidirectionalPath *operator*() const {
+            return it_->first;
+        }
+
+        const_iterator &operator++() {
+            if (++copy_ == it_->second) {
+                ++it_;
+                copy_ = 0;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        bool operator==(const const_iterator &other) const {
+            return it_ == other.it_ && copy_ == other.copy_;
+        }
+
+        bool operator!=(const const_iterator &other) const {
+            return !(*this == other);
+        }
+    };
+
+    CoveringPathsMultiset() : size_(0) {}
+
+    void insert(BidirectionalPath *path) {
+        auto it = Find(path);
+        if (it != paths_.end() && it->first == path) {
+            ++it->second;
+        } else {
+            paths_.insert(it, std::make_pair(path, 1));
+        }
+        ++size_;
+    }
+
+    //Removes a single occurrence of the path, returns false if there is no such path
+    bool erase_one(const BidirectionalPath *path) {
+        auto it = Find(path);
+        if (it == paths_.end() || it->first != path)
+            return false;
+        if (--it->second == 0)
+            paths_.erase(it);
+        --size_;
+        return true;
+    }
+
+    size_t count(const BidirectionalPath *path) const {
+        auto it = Find(path);
+        return it != paths_.end() && it->first == path ? it->second : 0;
+    }
+
+    //Distinct paths with their multiplicities
+    const std::vector<PathCount> &paths() const {
+        return paths_;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(paths_.begin());
+    }
+
+    const_iterator end() const {
+        return const_iterator(paths_.end());
+    }
+};
+
 // Handles all paths in PathContainer.
 // For each edge output all paths  that _traverse_ this path. If path contains multiple instances - count them. Position of the edge is not reported.
+// Entries are addressed by the edge id through the dense array of positions.
 class GraphCoverageMap: public PathListener {
 public:
-    typedef BidirectionalPathMultiset MapDataT;
+    typedef CoveringPathsMultiset MapDataT;
+    typedef std::deque<std::pair<EdgeId, MapDataT>> EntriesT;
 
 private:
+    static const uint32_t NoEntry = std::numeric_limits<uint32_t>::max();
+
     const Graph& g_;
 
-    std::unordered_map<EdgeId, MapDataT * > edge_coverage_;
+    //Deque keeps the pointers returned by GetEdgePaths valid while new entries are added
+    EntriesT entries_;
+    std::vector<uint32_t> positions_;
     const MapDataT empty_;
 
+    //Overlay mode: the edges absent in this map are looked up in base_,
+    //every looked up edge is appended to footprint_
+    const GraphCoverageMap *base_;
+    std::vector<EdgeId> *footprint_;
+
+    const MapDataT *LocalEntry(EdgeId e) const {
+        size_t id = e.int_id();
+        if (id >= positions_.size() || positions_[id] == NoEntry)
+            return nullptr;
+        return &entries_[positions_[id]].second;
+    }
+
+    MapDataT &AddEntry(EdgeId e, const MapDataT &data) {
+        size_t id = e.int_id();
+        if (id >= positions_.size())
+            positions_.resize(std::max(id + 1, 2 * positions_.size()), uint32_t(NoEntry));
+        VERIFY(entries_.size() < NoEntry);
+        positions_[id] = (uint32_t) entries_.size();
+        entries_.emplace_back(e, data);
+        return entries_.back().second;
+    }
+
+    //Local entry for the edge, copied from the base map in overlay mode
+    MapDataT *Entry(EdgeId e) {
+        if (const MapDataT *data = LocalEntry(e))
+            return const_cast<MapDataT *>(data);
+        if (!base_)
+            return nullptr;
+        const MapDataT *base_data = base_->GetEdgePaths(e);
+        if (base_data->empty())
+            return nullptr;
+        return &AddEntry(e, *base_data);
+    }
+
     void EdgeAdded(EdgeId e, BidirectionalPath * path) {
-        auto iter = edge_coverage_.find(e);
-        if (iter == edge_coverage_.end()) {
-            edge_coverage_.insert(std::make_pair(e, new MapDataT()));
-        }
-        edge_coverage_[e]->insert(path);
+        MapDataT *data = Entry(e);
+        if (!data)
+            data = &AddEntry(e, MapDataT());
+        data->insert(path);
     }
 
     void EdgeRemoved(EdgeId e, BidirectionalPath * path) {
-        auto iter = edge_coverage_.find(e);
-        if (iter != edge_coverage_.end()) {
-            if (iter->second->count(path) == 0) {
-                DEBUG("Error erasing path from coverage map");
-            } else {
-                auto entry = iter->second->find(path);
-                iter->second->erase(entry);
-            }
+        MapDataT *data = Entry(e);
+        if (data && !data->erase_one(path)) {
+            DEBUG("Error erasing path from coverage map");
         }
     }
 
@@ -75,10 +222,10 @@ private:
         }
     }
 
-    size_t EdgeCount() const {
+    size_t MaxEdgeId() const {
         size_t result = 0;
         for (auto e = g_.ConstEdgeBegin(); !e.IsEnd(); ++e) {
-            ++result;
+            result = std::max(result, g_.int_id(*e));
         }
         return result;
     }
@@ -90,20 +237,27 @@ public:
     GraphCoverageMap(GraphCoverageMap&&) = default;
     GraphCoverageMap& operator=(GraphCoverageMap&&) = default;
 
-    explicit GraphCoverageMap(const Graph& g) : g_(g) {
+    explicit GraphCoverageMap(const Graph& g) : g_(g), base_(nullptr), footprint_(nullptr) {
         //FIXME heavy constructor
-        edge_coverage_.reserve(EdgeCount());
+        positions_.resize(MaxEdgeId() + 1, uint32_t(NoEntry));
     }
 
+    //Copy-on-write view of the base map, which is never modified through the overlay.
+    //Edges looked up via the overlay are recorded into the footprint (if any).
+    GraphCoverageMap(const GraphCoverageMap& base, std::vector<EdgeId> *footprint) :
+            g_(base.g_), base_(&base), footprint_(footprint) {}
+
     GraphCoverageMap(const Graph& g, const PathContainer& paths, bool subscribe = false) :
             GraphCoverageMap(g) {
         AddPaths(paths, subscribe);
     }
 
-    ~GraphCoverageMap() {
-        for (auto iter = edge_coverage_.begin(); iter != edge_coverage_.end(); ++iter) {
-            delete iter->second;
+    //Forgets all the paths (the changes made to the base map in overlay mode)
+    void Clear() {
+        for (const auto &entry : entries_) {
+            positions_[entry.first.int_id()] = NoEntry;
         }
+        entries_.clear();
     }
 
     void AddPaths(const PathContainer& paths, bool subscribe = false) {
@@ -138,9 +292,14 @@ public:
     }
 
     const MapDataT *  GetEdgePaths(EdgeId e) const {
-        auto iter = edge_coverage_.find(e);
-        if (iter != edge_coverage_.end()) {
-            return iter->second;
+        if (footprint_) {
+            footprint_->push_back(e);
+        }
+        if (const MapDataT *data = LocalEntry(e)) {
+            return data;
+        }
+        if (base_) {
+            return base_->GetEdgePaths(e);
         }
         return &empty_;
     }
@@ -163,20 +322,24 @@ public:
     }
 
     BidirectionalPathSet GetCoveringPaths(EdgeId e) const {
-        auto mapData = GetEdgePaths(e);
-        return BidirectionalPathSet(mapData->begin(), mapData->end());
+        BidirectionalPathSet result;
+        //Paths are already sorted by id, so every insertion is O(1) with the hint
+        for (const auto &entry : GetEdgePaths(e)->paths()) {
+            result.insert(result.end(), entry.first);
+        }
+        return result;
     }
 
-    std::unordered_map <EdgeId, MapDataT * >::const_iterator begin() const {
-        return edge_coverage_.begin();
+    EntriesT::const_iterator begin() const {
+        return entries_.begin();
     }
 
-    std::unordered_map <EdgeId, MapDataT * >::const_iterator end() const {
-        return edge_coverage_.end();
+    EntriesT::const_iterator end() const {
+        return entries_.end();
     }
 
     size_t size() const {
-        return edge_coverage_.size();
+        return entries_.size();
     }
 
     const Graph& graph() const {
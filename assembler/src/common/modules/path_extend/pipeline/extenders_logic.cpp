@@ -43,10 +43,16 @@ shared_ptr<SimpleExtender> ExtendersGenerator::MakeLongReadsExtender(size_t lib_
                                        support_.UseCoverageResolverForSingleReads(lib.type()));
 }
 
+shared_ptr<PairedInfoLibrary> ExtendersGenerator::MakeClusteredLib(size_t lib_index) const {
+    const auto &lib = dataset_info_.reads[lib_index];
+    if (lib_index < compressed_indices_.size())
+        return MakeNewLib(gp_.g, lib, compressed_indices_[lib_index]);
+    return MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+}
+
 shared_ptr<SimpleExtender> ExtendersGenerator::MakeLongEdgePEExtender(size_t lib_index,
                                                                       bool investigate_loops) const {
-    const auto &lib = dataset_info_.reads[lib_index];
-    shared_ptr<PairedInfoLibrary> paired_lib = MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+    shared_ptr<PairedInfoLibrary> paired_lib = MakeClusteredLib(lib_index);
     //INFO("Threshold for lib #" << lib_index << ": " << paired_lib->GetSingleThreshold());
 
     shared_ptr<WeightCounter> wc =
@@ -159,7 +165,7 @@ shared_ptr<PathExtender> ExtendersGenerator::MakeMatePairScaffoldingExtender(siz
         paired_lib = MakeNewLib(gp_.g, lib, gp_.paired_indices[lib_index]);
     } else if (gp_.clustered_indices[lib_index].size() != 0) {
         INFO("clustered indices not empty, using them");
-        paired_lib = MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+        paired_lib = MakeClusteredLib(lib_index);
     } else {
         ERROR("All paired indices are empty!");
     }
@@ -190,7 +196,7 @@ shared_ptr<PathExtender> ExtendersGenerator::MakeMatePairScaffoldingExtender(siz
 
 shared_ptr<SimpleExtender> ExtendersGenerator::MakeCoordCoverageExtender(size_t lib_index) const {
     const auto& lib = dataset_info_.reads[lib_index];
-    shared_ptr<PairedInfoLibrary> paired_lib = MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+    shared_ptr<PairedInfoLibrary> paired_lib = MakeClusteredLib(lib_index);
 
     auto provider = make_shared<CoverageAwareIdealInfoProvider>(gp_.g, paired_lib, lib.data().unmerged_read_length);
 
@@ -221,7 +227,7 @@ shared_ptr<SimpleExtender> ExtendersGenerator::MakeCoordCoverageExtender(size_t
 shared_ptr<SimpleExtender> ExtendersGenerator::MakeRNAExtender(size_t lib_index, bool investigate_loops) const {
 
     const auto &lib = dataset_info_.reads[lib_index];
-    shared_ptr<PairedInfoLibrary> paired_lib = MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+    shared_ptr<PairedInfoLibrary> paired_lib = MakeClusteredLib(lib_index);
 //    INFO("Threshold for lib #" << lib_index << ": " << paired_lib->GetSingleThreshold());
 
     auto cip = make_shared<CoverageAwareIdealInfoProvider>(gp_.g, paired_lib, lib.data().unmerged_read_length);
@@ -265,7 +271,7 @@ shared_ptr<SimpleExtender> ExtendersGenerator::MakeSimpleCoverageExtender(size_t
 
 shared_ptr<SimpleExtender> ExtendersGenerator::MakePEExtender(size_t lib_index, bool investigate_loops) const {
     const auto &lib = dataset_info_.reads[lib_index];
-    shared_ptr<PairedInfoLibrary> paired_lib = MakeNewLib(gp_.g, lib, gp_.clustered_indices[lib_index]);
+    shared_ptr<PairedInfoLibrary> paired_lib = MakeClusteredLib(lib_index);
     VERIFY_MSG(!paired_lib->IsMp(), "Tried to create PE extender for MP library");
     auto opts = params_.pset.extension_options;
 //    INFO("Threshold for lib #" << lib_index << ": " << paired_lib->GetSingleThreshold());
@@ -6,6 +6,7 @@
 
 #include "modules/path_extend/path_extender.hpp"
 #include "launch_support.hpp"
+#include "paired_info/compressed_paired_info.hpp"
 
 namespace path_extend {
 
@@ -32,6 +33,10 @@ typedef vector<ExtenderTriplet> ExtenderTriplets;
 
 typedef vector<shared_ptr<PathExtender>> Extenders;
 
+typedef omnigraph::de::CompressedPairedInfoIndexT<Graph> CompressedPairedInfoIndex;
+//Read-only copies of the clustered indices (by library index), empty if they are not used
+typedef vector<CompressedPairedInfoIndex> CompressedIndices;
+
 inline Extenders ExtractExtenders(const ExtenderTriplets& triplets) {
     Extenders result;
     for (const auto& triplet : triplets)
@@ -50,6 +55,7 @@ class ExtendersGenerator {
     UsedUniqueStorage &used_unique_storage_;
 
     const PELaunchSupport &support_;
+    const CompressedIndices &compressed_indices_;
 
 public:
     ExtendersGenerator(const config::dataset &dataset_info,
@@ -58,14 +64,16 @@ public:
                        const GraphCoverageMap &cover_map,
                        const UniqueData &unique_data,
                        UsedUniqueStorage &used_unique_storage,
-                       const PELaunchSupport& support) :
+                       const PELaunchSupport& support,
+                       const CompressedIndices &compressed_indices) :
         dataset_info_(dataset_info),
         params_(params),
         gp_(gp),
         cover_map_(cover_map),
         unique_data_(unique_data),
         used_unique_storage_(used_unique_storage),
-        support_(support) { }
+        support_(support),
+        compressed_indices_(compressed_indices) { }
 
     Extenders MakePBScaffoldingExtenders() const;
 
@@ -79,6 +87,8 @@ public:
 
 private:
 
+    shared_ptr<PairedInfoLibrary> MakeClusteredLib(size_t lib_index) const;
+
     shared_ptr<SimpleExtender> MakePEExtender(size_t lib_index, bool investigate_loops) const;
 
     Extenders MakeMPExtenders(const ScaffoldingUniqueEdgeStorage &storage) const;
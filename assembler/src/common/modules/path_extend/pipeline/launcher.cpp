@@ -14,6 +14,7 @@
 #include "assembly_graph/graph_support/coverage_uniformity_analyzer.hpp"
 #include "assembly_graph/graph_support/scaff_supplementary.hpp"
 #include "modules/path_extend/scaffolder2015/path_polisher.hpp"
+#include "utils/perf/stage_profiler.hpp"
 
 
 namespace path_extend {
@@ -303,7 +304,7 @@ void PathExtendLauncher::AddScaffUniqueStorage(size_t uniqe_edge_len) {
     additional_edge_analyzer.FillUniqueEdgeStorage(unique_data_.unique_storages_.back());
 }
 
-Extenders PathExtendLauncher::ConstructMPExtenders(const ExtendersGenerator &generator) {
+void PathExtendLauncher::FillMPUniqueEdgeStorages() {
     const pe_config::ParamSetT &pset = params_.pset;
 
     size_t cur_length = unique_data_.min_unique_length_ - pset.scaffolding2015.unique_length_step;
@@ -318,8 +319,6 @@ Extenders PathExtendLauncher::ConstructMPExtenders(const ExtendersGenerator &gen
         INFO("Will add final extenders for length " << lower_bound);
         AddScaffUniqueStorage(lower_bound);
     }
-
-    return generator.MakeMPExtenders();
 }
 
 void PathExtendLauncher::FillPathContainer(size_t lib_index, size_t size_threshold) {
@@ -381,11 +380,19 @@ void  PathExtendLauncher::FillPBUniqueEdgeStorages() {
     INFO(unique_data_.unique_pb_storage_.size() << " unique edges");
 }
 
-Extenders PathExtendLauncher::ConstructPBExtenders(const ExtendersGenerator &generator) {
-    FillPBUniqueEdgeStorages();
-    return generator.MakePBScaffoldingExtenders();
-}
+void PathExtendLauncher::CompressClusteredIndices() {
+    if (!compressed_indices_.empty())
+        return;
 
+    compressed_indices_.reserve(dataset_info_.reads.lib_count());
+    for (size_t i = 0; i < dataset_info_.reads.lib_count(); ++i) {
+        compressed_indices_.emplace_back(gp_.g);
+        compressed_indices_.back().Init(gp_.clustered_indices[i]);
+        if (compressed_indices_.back().size() > 0)
+            INFO("Clustered paired info of lib #" << i << " compressed: " << compressed_indices_.back().size()
+                 << " points, " << compressed_indices_.back().memory_usage() / 1024 << " KB");
+    }
+}
 
 Extenders PathExtendLauncher::ConstructExtenders(const GraphCoverageMap &cover_map,
                                                  UsedUniqueStorage &used_unique_storage) {
@@ -393,16 +400,12 @@ Extenders PathExtendLauncher::ConstructExtenders(const GraphCoverageMap &cover_m
     if (support_.SingleReadsMapped() || support_.HasLongReads())
         FillLongReadsCoverageMaps();
 
-    ExtendersGenerator generator(dataset_info_, params_, gp_, cover_map,
-                                 unique_data_, used_unique_storage, support_);
-    Extenders extenders = generator.MakeBasicExtenders();
-
     //long reads scaffolding extenders.
     if (support_.HasLongReads()) {
         if (params_.pset.sm == sm_old) {
             INFO("Will not use new long read scaffolding algorithm in this mode");
         } else {
-            utils::push_back_all(extenders, ConstructPBExtenders(generator));
+            FillPBUniqueEdgeStorages();
         }
     }
 
@@ -410,14 +413,35 @@ Extenders PathExtendLauncher::ConstructExtenders(const GraphCoverageMap &cover_m
         if (params_.pset.sm == sm_old) {
             INFO("Will not use mate-pairs is this mode");
         } else {
-            utils::push_back_all(extenders, ConstructMPExtenders(generator));
+            FillMPUniqueEdgeStorages();
         }
     }
 
+    if (params_.pset.compressed_paired_info)
+        CompressClusteredIndices();
+
+    Extenders extenders = MakeExtenders(cover_map, used_unique_storage);
+    INFO("Total number of extenders is " << extenders.size());
+    return extenders;
+}
+
+//Unique edge storages should be filled beforehand, see ConstructExtenders
+Extenders PathExtendLauncher::MakeExtenders(const GraphCoverageMap &cover_map,
+                                            UsedUniqueStorage &used_unique_storage) const {
+    ExtendersGenerator generator(dataset_info_, params_, gp_, cover_map,
+                                 unique_data_, used_unique_storage, support_, compressed_indices_);
+    Extenders extenders = generator.MakeBasicExtenders();
+
+    if (params_.pset.sm != sm_old) {
+        if (support_.HasLongReads())
+            utils::push_back_all(extenders, generator.MakePBScaffoldingExtenders());
+        if (support_.HasMPReads())
+            utils::push_back_all(extenders, generator.MakeMPExtenders());
+    }
+
     if (params_.pset.use_coordinated_coverage)
         utils::push_back_all(extenders, generator.MakeCoverageExtenders());
 
-    INFO("Total number of extenders is " << extenders.size());
     return extenders;
 }
 
@@ -483,12 +507,16 @@ void PathExtendLauncher::Launch() {
     make_dir(params_.etc_dir);
 
     if (support_.NeedsUniqueEdgeStorage()) {
+        utils::ProfiledScope profile("Unique edges");
         //Fill the storage to enable unique edge check
         EstimateUniqueEdgesParams();
         FillUniqueEdgeStorage();
     }
 
-    MakeAndOutputScaffoldGraph();
+    {
+        utils::ProfiledScope profile("Scaffold graph");
+        MakeAndOutputScaffoldGraph();
+    }
 
     PathExtendResolver resolver(gp_.g);
 
@@ -502,23 +530,45 @@ void PathExtendLauncher::Launch() {
     CompositeExtender composite_extender(gp_.g, cover_map,
                                          used_unique_storage,
                                          extenders);
+    if (params_.pset.parallel_extension) {
+        INFO("Paths will be grown in parallel");
+        composite_extender.EnableParallelGrowth([this](const GraphCoverageMap &map, UsedUniqueStorage &storage) {
+            return MakeExtenders(map, storage);
+        });
+    }
 
-    auto paths = resolver.ExtendSeeds(seeds, composite_extender);
+    PathContainer paths;
+    {
+        utils::ProfiledScope profile("Path extension");
+        paths = resolver.ExtendSeeds(seeds, composite_extender);
+    }
     DebugOutputPaths(paths, "raw_paths");
 
-    RemoveOverlapsAndArtifacts(paths, cover_map, resolver);
+    {
+        utils::ProfiledScope profile("Overlap removal");
+        RemoveOverlapsAndArtifacts(paths, cover_map, resolver);
+    }
     DebugOutputPaths(paths, "before_path_polishing");
 
-    //TODO does path polishing correctly work with coverage map
-    PolishPaths(paths, gp_.contig_paths, cover_map);
+    {
+        utils::ProfiledScope profile("Path polishing");
+        //TODO does path polishing correctly work with coverage map
+        PolishPaths(paths, gp_.contig_paths, cover_map);
+    }
     //TODO use move assignment to original map here
     GraphCoverageMap polished_map(gp_.g, gp_.contig_paths, true);
     DebugOutputPaths(gp_.contig_paths, "polished_paths");
 
-    TraverseLoops(gp_.contig_paths, polished_map);
+    {
+        utils::ProfiledScope profile("Loop traversal");
+        TraverseLoops(gp_.contig_paths, polished_map);
+    }
     DebugOutputPaths(gp_.contig_paths, "loop_traveresed");
 
-    RemoveOverlapsAndArtifacts(gp_.contig_paths, polished_map, resolver);
+    {
+        utils::ProfiledScope profile("Final overlap removal");
+        RemoveOverlapsAndArtifacts(gp_.contig_paths, polished_map, resolver);
+    }
     DebugOutputPaths(gp_.contig_paths, "overlap_removed");
 
     if (params_.ss.ss_enabled) {
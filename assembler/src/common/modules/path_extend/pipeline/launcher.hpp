@@ -29,6 +29,7 @@ class PathExtendLauncher {
     ContigWriter writer_;
 
     UniqueData unique_data_;
+    CompressedIndices compressed_indices_;
 
     vector<shared_ptr<ConnectionCondition>>
         ConstructPairedConnectionConditions(const ScaffoldingUniqueEdgeStorage& edge_storage) const;
@@ -69,11 +70,13 @@ class PathExtendLauncher {
 
     Extenders ConstructExtenders(const GraphCoverageMap &cover_map, UsedUniqueStorage &used_unique_storage);
 
-    Extenders ConstructMPExtenders(const ExtendersGenerator &generator);
+    Extenders MakeExtenders(const GraphCoverageMap &cover_map, UsedUniqueStorage &used_unique_storage) const;
 
-    void AddScaffUniqueStorage(size_t uniqe_edge_len);
+    void FillMPUniqueEdgeStorages();
+
+    void CompressClusteredIndices();
 
-    Extenders ConstructPBExtenders(const ExtendersGenerator &generator);
+    void AddScaffUniqueStorage(size_t uniqe_edge_len);
 
     void FilterPaths();
 
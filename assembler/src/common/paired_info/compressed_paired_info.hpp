@@ -0,0 +1,539 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "histogram.hpp"
+#include "index_point.hpp"
+#include "utils/verify.hpp"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+namespace omnigraph {
+
+namespace de {
+
+namespace compressed {
+
+// Distances and variances are stored with 1/16 bp resolution, weights with 1/256
+static const float DistanceScale = 16.0f;
+static const float WeightScale = 256.0f;
+
+inline void PutVarint(std::vector<uint8_t> &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+inline const uint8_t *GetVarint(const uint8_t *p, uint64_t &v) {
+    uint64_t res = 0;
+    unsigned shift = 0;
+    while (*p & 0x80) {
+        res |= uint64_t(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    v = res | (uint64_t(*p++) << shift);
+    return p;
+}
+
+inline int64_t QuantizeDistance(float d) {
+    return std::llround(double(d) * DistanceScale);
+}
+
+inline uint64_t QuantizeWeight(float w) {
+    return (uint64_t) std::llround(std::max(double(w), 0.0) * WeightScale);
+}
+
+inline void PutVariance(std::vector<uint8_t> &, const RawGapPoint &) {}
+
+inline void PutVariance(std::vector<uint8_t> &out, const GapPoint &p) {
+    PutVarint(out, (uint64_t) QuantizeDistance(std::max(p.var, 0.0f)));
+}
+
+inline const uint8_t *GetVariance(const uint8_t *p, RawGapPoint &) {
+    return p;
+}
+
+inline const uint8_t *GetVariance(const uint8_t *p, GapPoint &res) {
+    uint64_t v;
+    p = GetVarint(p, v);
+    res.var = DEVariance(float(v) / DistanceScale);
+    return p;
+}
+
+// Every point is encoded as zigzagged delta of the quantized distance wrt the
+// previous point of the histogram, followed by the quantized weight (and
+// variance for clustered points).
+template<class InnerPoint>
+void EncodePoint(std::vector<uint8_t> &out, int64_t &prev, const InnerPoint &p) {
+    int64_t d = QuantizeDistance(p.d);
+    int64_t delta = d - prev;
+    prev = d;
+    PutVarint(out, (uint64_t(delta) << 1) ^ uint64_t(delta >> 63));
+    PutVarint(out, QuantizeWeight(p.weight));
+    PutVariance(out, p);
+}
+
+template<class InnerPoint>
+const uint8_t *DecodePoint(const uint8_t *pos, int64_t &prev, InnerPoint &p) {
+    uint64_t v;
+    pos = GetVarint(pos, v);
+    prev += int64_t(v >> 1) ^ -int64_t(v & 1);
+    p.d = DEGap(float(prev) / DistanceScale);
+    pos = GetVarint(pos, v);
+    p.weight = DECropWeight(float(v) / WeightScale);
+    return GetVariance(pos, p);
+}
+
+}
+
+/**
+ * @brief Immutable read-optimized paired info storage in compressed sparse row layout.
+ *        Only the first edges having some paired info get a row, rows are sorted by
+ *        the first edge. For every row there is a sorted block of second edges, every
+ *        pair refers to a byte range with the delta-encoded histogram.
+ *        Distances and weights are quantized (see compressed::DistanceScale / WeightScale),
+ *        points are stored relative to the first edge length (like in PairedIndex), so
+ *        the accessors mimic the read-only part of PairedIndex interface and could be used
+ *        in its place by the consumers templated on the index type (see path_extend::MakeNewLib).
+ *        The storage is built via Builder from one or several PairedIndex / PairedBuffer
+ *        instances; Merge rebuilds it adding the contents of a (concurrent) buffer.
+ * @param G graph type
+ * @param Traits Policy-like structure with associated types of inner and resulting points
+ */
+template<typename G, typename Traits>
+class CompressedPairedIndex {
+    typedef CompressedPairedIndex<G, Traits> self;
+    typedef typename Traits::Gapped InnerPoint;
+
+public:
+    typedef G Graph;
+    typedef typename Graph::EdgeId EdgeId;
+    typedef std::pair<EdgeId, EdgeId> EdgePair;
+    typedef typename Traits::Expanded Point;
+    typedef omnigraph::de::Histogram<Point> Histogram;
+
+    /**
+     * @brief Proxy set of points between two edges decoded on-the-fly.
+     */
+    class HistProxy {
+    public:
+        class Iterator: public boost::iterator_facade<Iterator, Point, boost::forward_traversal_tag, Point> {
+        public:
+            Iterator(const uint8_t *pos, size_t left, DEDistance offset)
+                    : pos_(pos), next_(pos), left_(left), prev_(0), offset_(offset) {
+                Load();
+            }
+
+        private:
+            friend class boost::iterator_core_access;
+
+            void Load() {
+                if (left_)
+                    next_ = compressed::DecodePoint(pos_, prev_, point_);
+            }
+
+            Point dereference() const {
+                return Traits::Expand(point_, offset_);
+            }
+
+            void increment() {
+                pos_ = next_;
+                left_ -= 1;
+                Load();
+            }
+
+            bool equal(const Iterator &other) const {
+                return left_ == other.left_;
+            }
+
+            const uint8_t *pos_;
+            const uint8_t *next_;
+            size_t left_;
+            int64_t prev_;
+            InnerPoint point_;
+            DEDistance offset_;
+        };
+
+        HistProxy(const uint8_t *data = nullptr, size_t size = 0, DEDistance offset = 0)
+                : data_(data), size_(size), offset_(offset) {}
+
+        Iterator begin() const { return Iterator(data_, size_, offset_); }
+        Iterator end() const { return Iterator(data_, 0, offset_); }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        /**
+         * @brief Finds the point with the minimal distance.
+         */
+        Point min() const {
+            VERIFY(!empty());
+            return *begin();
+        }
+
+        /**
+         * @brief Finds the point with the maximal distance.
+         */
+        Point max() const {
+            VERIFY(!empty());
+            Point res = *begin();
+            for (const auto &p : *this)
+                res = p;
+            return res;
+        }
+
+        /**
+         * @brief Returns the copy of all points in a simple flat histogram.
+         */
+        Histogram Unwrap() const {
+            return Histogram(begin(), end());
+        }
+
+    private:
+        const uint8_t *data_;
+        size_t size_;
+        DEDistance offset_;
+    };
+
+    typedef typename HistProxy::Iterator HistIterator;
+    using EdgeHist = std::pair<EdgeId, HistProxy>;
+
+    /**
+     * @brief Proxy map representing the neighbourhood of an edge.
+     *        Half proxy skips the pairs greater than their conjugates.
+     */
+    class EdgeProxy {
+    public:
+        class Iterator: public boost::iterator_facade<Iterator, EdgeHist, boost::forward_traversal_tag, EdgeHist> {
+        public:
+            Iterator(const CompressedPairedIndex &index, size_t pos, size_t stop, EdgeId edge, bool half)
+                    : index_(&index), pos_(pos), stop_(stop), edge_(edge), half_(half) {
+                Skip();
+            }
+
+        private:
+            friend class boost::iterator_core_access;
+
+            void Skip() {
+                while (half_ && pos_ != stop_ && index_->GreaterPair(edge_, index_->columns_[pos_]))
+                    ++pos_;
+            }
+
+            void increment() {
+                ++pos_;
+                Skip();
+            }
+
+            bool equal(const Iterator &other) const {
+                return pos_ == other.pos_;
+            }
+
+            EdgeHist dereference() const {
+                return std::make_pair(index_->columns_[pos_], index_->Hist(pos_, edge_));
+            }
+
+            const CompressedPairedIndex *index_;
+            size_t pos_, stop_;
+            EdgeId edge_;
+            bool half_;
+        };
+
+        EdgeProxy(const CompressedPairedIndex &index, size_t start, size_t stop, EdgeId edge, bool half = false)
+                : index_(index), start_(start), stop_(stop), edge_(edge), half_(half) {}
+
+        Iterator begin() const { return Iterator(index_, start_, stop_, edge_, half_); }
+        Iterator end() const { return Iterator(index_, stop_, stop_, edge_, half_); }
+
+        HistProxy operator[](EdgeId e2) const {
+            if (half_ && index_.GreaterPair(edge_, e2))
+                return HistProxy();
+            return index_.Get(edge_, e2);
+        }
+
+        bool empty() const { return start_ == stop_; }
+
+    private:
+        const CompressedPairedIndex &index_;
+        size_t start_, stop_;
+        EdgeId edge_;
+        bool half_;
+    };
+
+    /**
+     * @brief Collects the points from several sources, sorts and merges them,
+     *        and finally encodes into the compressed storage.
+     */
+    class Builder {
+        struct Entry {
+            EdgeId e1, e2;
+            InnerPoint p;
+        };
+
+    public:
+        Builder(const Graph &graph)
+                : graph_(graph) {}
+
+        void Add(EdgeId e1, EdgeId e2, InnerPoint p) {
+            entries_.push_back({ e1, e2, p });
+        }
+
+        /**
+         * @brief Adds all the histograms of PairedIndex / PairedBuffer-like index.
+         */
+        template<class Index>
+        void AddIndex(const Index &index) {
+            for (auto it = index.data_begin(); it != index.data_end(); ++it)
+                AddRow(it->first, it->second);
+        }
+
+        /**
+         * @brief Adds all the histograms of ConcurrentPairedBuffer. The buffer is locked meanwhile.
+         */
+        template<class Buffer>
+        void AddBuffer(Buffer &buffer) {
+            auto locked_table = buffer.lock_table();
+            for (auto &kvpair : locked_table)
+                AddRow(kvpair.first, kvpair.second);
+        }
+
+        void AddIndex(const CompressedPairedIndex &index) {
+            for (size_t r = 0; r < index.row_edges_.size(); ++r) {
+                for (size_t i = index.rows_[r]; i < index.rows_[r + 1]; ++i) {
+                    // Decode the inner points as is, there is no need to expand them
+                    const uint8_t *pos = index.data_.data() + index.offsets_[i];
+                    uint64_t count;
+                    pos = compressed::GetVarint(pos, count);
+                    int64_t prev = 0;
+                    for (size_t j = 0; j < count; ++j) {
+                        InnerPoint p;
+                        pos = compressed::DecodePoint(pos, prev, p);
+                        Add(index.row_edges_[r], index.columns_[i], p);
+                    }
+                }
+            }
+        }
+
+        void Build(CompressedPairedIndex &index) {
+            auto key = [](const Entry &e) {
+                return std::make_tuple(e.e1, e.e2, compressed::QuantizeDistance(e.p.d));
+            };
+            std::sort(entries_.begin(), entries_.end(),
+                      [&](const Entry &a, const Entry &b) { return key(a) < key(b); });
+
+            index.Clear();
+            std::vector<InnerPoint> hist;
+            for (size_t i = 0; i < entries_.size(); ) {
+                const Entry &first = entries_[i];
+                hist.clear();
+                for (; i < entries_.size() && first.e1 == entries_[i].e1 && first.e2 == entries_[i].e2; ++i) {
+                    const InnerPoint &p = entries_[i].p;
+                    if (!hist.empty() &&
+                        compressed::QuantizeDistance(hist.back().d) == compressed::QuantizeDistance(p.d))
+                        hist.back() = hist.back() + p;
+                    else
+                        hist.push_back(p);
+                }
+
+                if (index.row_edges_.empty() || index.row_edges_.back() != first.e1) {
+                    index.row_edges_.push_back(first.e1);
+                    index.rows_.push_back(index.columns_.size());
+                }
+                index.columns_.push_back(first.e2);
+                index.offsets_.push_back(index.data_.size());
+                compressed::PutVarint(index.data_, hist.size());
+                int64_t prev = 0;
+                for (const auto &p : hist)
+                    compressed::EncodePoint(index.data_, prev, p);
+                index.size_ += hist.size();
+            }
+            index.offsets_.push_back(index.data_.size());
+            index.rows_.push_back(index.columns_.size());
+
+            index.row_edges_.shrink_to_fit();
+            index.rows_.shrink_to_fit();
+            index.data_.shrink_to_fit();
+            index.columns_.shrink_to_fit();
+            index.offsets_.shrink_to_fit();
+            std::vector<Entry>().swap(entries_);
+        }
+
+    private:
+        template<class Map>
+        void AddRow(EdgeId e1, const Map &map) {
+            for (const auto &entry : map)
+                for (const auto &p : *entry.second)
+                    Add(e1, entry.first, p);
+        }
+
+        const Graph &graph_;
+        std::vector<Entry> entries_;
+    };
+
+    CompressedPairedIndex(const Graph &graph)
+            : graph_(graph), size_(0) {
+        Clear();
+    }
+
+    /**
+     * @brief Builds the storage from PairedIndex / PairedBuffer-like index.
+     */
+    template<class Index>
+    void Init(const Index &index) {
+        Builder builder(graph_);
+        builder.AddIndex(index);
+        builder.Build(*this);
+    }
+
+    /**
+     * @brief Adds the contents of a concurrent buffer rebuilding the whole storage.
+     */
+    template<class Buffer>
+    void Merge(Buffer &buffer) {
+        if (buffer.size() == 0)
+            return;
+
+        Builder builder(graph_);
+        builder.AddIndex(*this);
+        builder.AddBuffer(buffer);
+        builder.Build(*this);
+    }
+
+    void Clear() {
+        row_edges_.clear();
+        rows_.clear();
+        columns_.clear();
+        offsets_.clear();
+        data_.clear();
+        size_ = 0;
+    }
+
+    const Graph &graph() const { return graph_; }
+
+    /**
+     * @brief Returns the total count of points in all the histograms.
+     */
+    size_t size() const { return size_; }
+
+    /**
+     * @brief Returns the count of edge pairs with non-empty histograms.
+     */
+    size_t pairs() const { return columns_.size(); }
+
+    /**
+     * @brief Returns the amount of memory allocated by the storage.
+     */
+    size_t memory_usage() const {
+        return sizeof(*this) +
+                row_edges_.capacity() * sizeof(EdgeId) + rows_.capacity() * sizeof(size_t) +
+                columns_.capacity() * sizeof(EdgeId) + offsets_.capacity() * sizeof(size_t) +
+                data_.capacity();
+    }
+
+    EdgePair ConjugatePair(EdgeId e1, EdgeId e2) const {
+        return std::make_pair(graph_.conjugate(e2), graph_.conjugate(e1));
+    }
+
+    /**
+     * @brief Returns a whole proxy map to the neighbourhood of some edge.
+     */
+    EdgeProxy Get(EdgeId e) const {
+        auto range = Row(e);
+        return EdgeProxy(*this, range.first, range.second, e);
+    }
+
+    /**
+     * @brief Returns a half proxy map to the neighbourhood of some edge.
+     */
+    EdgeProxy GetHalf(EdgeId e) const {
+        auto range = Row(e);
+        return EdgeProxy(*this, range.first, range.second, e, true);
+    }
+
+    EdgeProxy operator[](EdgeId e) const {
+        return Get(e);
+    }
+
+    /**
+     * @brief Returns a histogram proxy for all points between two edges.
+     */
+    HistProxy Get(EdgeId e1, EdgeId e2) const {
+        size_t pos = Find(e1, e2);
+        if (pos == -1ULL)
+            return HistProxy();
+        return Hist(pos, e1);
+    }
+
+    HistProxy operator[](EdgePair p) const {
+        return Get(p.first, p.second);
+    }
+
+    bool contains(EdgeId edge) const {
+        auto range = Row(edge), conj = Row(graph_.conjugate(edge));
+        return range.first != range.second || conj.first != conj.second;
+    }
+
+    bool contains(EdgeId e1, EdgeId e2) const {
+        return Find(e1, e2) != -1ULL;
+    }
+
+private:
+    bool GreaterPair(EdgeId e1, EdgeId e2) const {
+        auto ep = std::make_pair(e1, e2);
+        return ep > ConjugatePair(e1, e2);
+    }
+
+    std::pair<size_t, size_t> Row(EdgeId e) const {
+        auto it = std::lower_bound(row_edges_.begin(), row_edges_.end(), e);
+        if (it == row_edges_.end() || *it != e)
+            return { 0, 0 };
+        size_t r = it - row_edges_.begin();
+        return { rows_[r], rows_[r + 1] };
+    }
+
+    size_t Find(EdgeId e1, EdgeId e2) const {
+        auto range = Row(e1);
+        auto b = columns_.begin() + range.first, e = columns_.begin() + range.second;
+        auto it = std::lower_bound(b, e, e2);
+        if (it == e || *it != e2)
+            return -1ULL;
+        return it - columns_.begin();
+    }
+
+    HistProxy Hist(size_t pos, EdgeId e1) const {
+        uint64_t count;
+        const uint8_t *data = compressed::GetVarint(data_.data() + offsets_[pos], count);
+        return HistProxy(data, count, DEDistance(graph_.length(e1)));
+    }
+
+    const Graph &graph_;
+    // sorted first edges, row -> the range of its second edges in columns_
+    std::vector<EdgeId> row_edges_;
+    std::vector<size_t> rows_;
+    std::vector<EdgeId> columns_;
+    // column -> the beginning of the encoded histogram in data_
+    std::vector<size_t> offsets_;
+    std::vector<uint8_t> data_;
+    size_t size_;
+};
+
+template<class Graph>
+using CompressedPairedInfoIndexT = CompressedPairedIndex<Graph, PointTraits>;
+
+template<class Graph>
+using CompressedUnclusteredPairedInfoIndexT = CompressedPairedIndex<Graph, RawPointTraits>;
+
+}
+
+}
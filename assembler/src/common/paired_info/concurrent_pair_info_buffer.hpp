@@ -8,10 +8,14 @@
 
 #include "histogram.hpp"
 #include "histptr.hpp"
+#include "paired_info_buffer.hpp"
 
 #include <btree/btree_map.h>
 #include <cuckoo/cuckoohash_map.hh>
 
+#include <algorithm>
+#include <vector>
+
 namespace omnigraph {
 
 namespace de {
@@ -112,9 +116,201 @@ class ConcurrentPairedBuffer : public PairedBufferBase<ConcurrentPairedBuffer<G,
     StorageMap storage_;
 };
 
+/**
+ * @brief Paired info buffer for the lock-free concurrent filling.
+ *        Every thread appends the points (in the canonical orientation of the conjugate pair)
+ *        to its own arenas partitioned by the hash of the first edge. Arenas are sorted and
+ *        reduced in place when they grow too large, so repeated points do not pile up.
+ *        Finalize() sorts and reduces every shard independently in parallel and moves the
+ *        resulting histograms into the storage, which is accessible only after that.
+ */
+template<typename G, typename Traits, template<typename, typename> class Container>
+class ShardedPairedBuffer : public PairedBuffer<G, Traits, Container> {
+    typedef ShardedPairedBuffer<G, Traits, Container> self;
+    typedef PairedBuffer<G, Traits, Container> base;
+
+  protected:
+    using typename base::InnerPoint;
+    using typename base::InnerHistogram;
+    using typename base::InnerHistPtr;
+
+  public:
+    using typename base::Graph;
+    using typename base::EdgeId;
+    using typename base::EdgePair;
+    using typename base::Point;
+    using typename base::InnerMap;
+
+  private:
+    struct Entry {
+        EdgeId e1, e2;
+        InnerPoint p;
+
+        bool operator<(const Entry &other) const {
+            if (e1 != other.e1)
+                return e1 < other.e1;
+            if (e2 != other.e2)
+                return e2 < other.e2;
+            return p < other.p;
+        }
+
+        bool SameKey(const Entry &other) const {
+            return e1 == other.e1 && e2 == other.e2 && !(p < other.p) && !(other.p < p);
+        }
+    };
+
+    struct Arena {
+        std::vector<Entry> entries;
+        size_t limit;
+    };
+
+    struct Row {
+        EdgeId e1, e2;
+        InnerHistogram *hist;
+    };
+
+    static const size_t MinArenaLimit = 1 << 12;
+
+  public:
+    ShardedPairedBuffer(const Graph &g, size_t threads = 1, size_t shards = 0)
+            : base(g), shards_(shards) {
+        clear(threads);
+    }
+
+    //---------------- Data inserting methods ----------------
+
+    /**
+     * @brief Adds a point between two edges. Safe to be called concurrently
+     *        with the distinct thread indices.
+     */
+    void Add(size_t thread, EdgeId e1, EdgeId e2, Point p) {
+        VERIFY(thread < arenas_.size());
+        InnerPoint sp = Traits::Shrink(p, this->CalcOffset(e1));
+        EdgePair minep = this->MinMaxConjugatePair({ e1, e2 }).first;
+        if (this->IsSelfConj(e1, e2)) // This would double the weigth of self-conjugate pairs
+            sp = sp + sp;
+
+        Arena &arena = arenas_[thread][Shard(minep.first)];
+        arena.entries.push_back({ minep.first, minep.second, sp });
+        if (arena.entries.size() < arena.limit)
+            return;
+
+        Reduce(arena.entries);
+        // Do not bother compacting the arena again unless it grows twice
+        arena.limit = 2 * arena.entries.size();
+        if (arena.limit < MinArenaLimit)
+            arena.limit = MinArenaLimit;
+    }
+
+    /**
+     * @brief Moves all the points added so far into the storage.
+     */
+    void Finalize() {
+        std::vector<std::vector<Row>> rows(shards_);
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t shard = 0; shard < shards_; ++shard)
+            BuildShard(shard, rows[shard]);
+
+        // Only histogram pointers are moved here, no points are copied
+        for (const auto &shard : rows) {
+            for (const Row &row : shard)
+                Insert(row.e1, row.e2, row.hist);
+        }
+    }
+
+    //---------------- Miscellaneous ----------------
+
+    /**
+     * @brief Clears the whole index and prepares the arenas for the given number of threads.
+     */
+    void clear(size_t threads) {
+        VERIFY(threads > 0);
+        base::clear();
+        if (shards_ == 0)
+            shards_ = 4 * threads;
+        arenas_.assign(threads, std::vector<Arena>(shards_, Arena{ {}, MinArenaLimit }));
+    }
+
+    void clear() {
+        clear(arenas_.size());
+    }
+
+  private:
+    size_t Shard(EdgeId e) const {
+        uint64_t h = uint64_t(this->graph().int_id(e)) * 0x9e3779b97f4a7c15ULL;
+        return size_t(h >> 32) % shards_;
+    }
+
+    // Sorts the entries and merges the ones with the same edge pair and distance
+    static void Reduce(std::vector<Entry> &entries) {
+        if (entries.empty())
+            return;
+
+        std::sort(entries.begin(), entries.end());
+        size_t last = 0;
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (entries[i].SameKey(entries[last]))
+                entries[last].p = entries[last].p + entries[i].p;
+            else
+                entries[++last] = entries[i];
+        }
+        entries.resize(last + 1);
+    }
+
+    void BuildShard(size_t shard, std::vector<Row> &rows) {
+        std::vector<Entry> entries;
+        for (auto &arenas : arenas_) {
+            auto &arena = arenas[shard].entries;
+            entries.insert(entries.end(), arena.begin(), arena.end());
+            std::vector<Entry>().swap(arena);
+            arenas[shard].limit = MinArenaLimit;
+        }
+
+        Reduce(entries);
+        for (size_t i = 0; i < entries.size(); ) {
+            size_t j = i;
+            while (j < entries.size() && entries[j].e1 == entries[i].e1 && entries[j].e2 == entries[i].e2)
+                ++j;
+
+            // Points are already sorted and unique
+            InnerHistogram *hist = new InnerHistogram();
+            for (size_t k = i; k < j; ++k)
+                hist->insert(hist->end(), entries[k].p);
+            rows.push_back({ entries[i].e1, entries[i].e2, hist });
+            i = j;
+        }
+    }
+
+    void Insert(EdgeId e1, EdgeId e2, InnerHistogram *hist) {
+        bool selfconj = this->IsSelfConj(e1, e2);
+        InnerMap &second = this->storage_[e1];
+        auto it = second.find(e2);
+        size_t added = hist->size();
+        if (it != second.end()) {
+            // Finalize() was called before, the conjugate view is already there
+            added = it->second->merge(*hist);
+            delete hist;
+        } else {
+            second.insert(std::make_pair(e2, InnerHistPtr(hist, /* owning */ true)));
+            if (!selfconj) {
+                EdgePair conj = this->ConjugatePair(e1, e2);
+                auto res = this->storage_[conj.first].insert(std::make_pair(conj.second, InnerHistPtr(hist, /* owning */ false)));
+                VERIFY_MSG(res.second, "Index insertion inconsistency");
+            }
+        }
+        this->size_ += (selfconj ? added : 2 * added);
+    }
+
+    size_t shards_;
+    std::vector<std::vector<Arena>> arenas_;
+};
+
 template<class Graph>
 using ConcurrentPairedInfoBuffer = ConcurrentPairedBuffer<Graph, RawPointTraits, btree_map>;
 
+template<class Graph>
+using ShardedPairedInfoBuffer = ShardedPairedBuffer<Graph, RawPointTraits, btree_map>;
+
 } // namespace de
 
 } // namespace omnigraph
@@ -1,5 +1,7 @@
 #include "distance_estimation.hpp"
 
+#include <memory>
+
 namespace omnigraph {
 namespace de {
 
@@ -14,10 +16,15 @@ std::vector<size_t> GraphDistanceFinder::GetGraphDistancesLengths(EdgeId e1, Edg
     return m[e2];
 }
 
+size_t GraphDistanceFinder::path_upper_bound() const {
+    return PairInfoPathLengthUpperBound(graph_.k(), insert_size_, delta_);
+}
+
 void GraphDistanceFinder::FillGraphDistancesLengths(EdgeId e1, LengthMap &second_edges) const {
-    vector<size_t> path_lower_bounds;
-    size_t path_upper_bound = PairInfoPathLengthUpperBound(graph_.k(), insert_size_, delta_);
-    PathProcessor <Graph> paths_proc(graph_, graph_.EdgeEnd(e1), path_upper_bound);
+    size_t path_upper_bound = this->path_upper_bound();
+    VertexId start = graph_.EdgeEnd(e1);
+    // created lazily, since all the queries might be answered by the oracle
+    std::unique_ptr<PathProcessor<Graph>> paths_proc;
 
     for (auto &entry : second_edges) {
         EdgeId e2 = entry.first;
@@ -26,9 +33,17 @@ void GraphDistanceFinder::FillGraphDistancesLengths(EdgeId e1, LengthMap &second
 
         TRACE("Bounds for paths are " << path_lower_bound << " " << path_upper_bound);
 
-        DistancesLengthsCallback<Graph> callback(graph_);
-        paths_proc.Process(graph_.EdgeStart(e2), path_lower_bound, path_upper_bound, callback);
-        GraphLengths lengths = callback.distances();
+        GraphLengths lengths;
+        if (oracle_ && oracle_->GetLengths(start, graph_.EdgeStart(e2), path_upper_bound, lengths)) {
+            lengths.erase(lengths.begin(),
+                          std::lower_bound(lengths.begin(), lengths.end(), path_lower_bound));
+        } else {
+            if (!paths_proc)
+                paths_proc.reset(new PathProcessor<Graph>(graph_, start, path_upper_bound));
+            DistancesLengthsCallback<Graph> callback(graph_);
+            paths_proc->Process(graph_.EdgeStart(e2), path_lower_bound, path_upper_bound, callback);
+            lengths = callback.distances();
+        }
         for (size_t j = 0; j < lengths.size(); ++j) {
             lengths[j] += graph_.length(e1);
             TRACE("Resulting distance set for " <<
@@ -12,6 +12,7 @@
 #include "assembly_graph/core/basic_graph_stats.hpp"
 #include "assembly_graph/core/graph.hpp"
 #include "assembly_graph/paths/path_processor.hpp"
+#include "assembly_graph/paths/distance_oracle.hpp"
 
 #include "paired_info/pair_info_bounds.hpp"
 #include "paired_info.hpp"
@@ -30,7 +31,14 @@ class GraphDistanceFinder {
 public:
     GraphDistanceFinder(const debruijn_graph::Graph &graph, size_t insert_size, size_t read_length, size_t delta) :
             graph_(graph), insert_size_(insert_size), gap_((int) (insert_size - 2 * read_length)),
-            delta_((double) delta) { }
+            delta_((double) delta), oracle_(nullptr) { }
+
+    // the oracle (if any) is used for the edges it covers with the same length bound
+    void SetOracle(const GraphDistanceOracle<debruijn_graph::Graph> *oracle) {
+        oracle_ = oracle;
+    }
+
+    size_t path_upper_bound() const;
 
     std::vector<size_t> GetGraphDistancesLengths(debruijn_graph::EdgeId e1, debruijn_graph::EdgeId e2) const;
 
@@ -43,6 +51,7 @@ private:
     const size_t insert_size_;
     const int gap_;
     const double delta_;
+    const GraphDistanceOracle<debruijn_graph::Graph> *oracle_;
 };
 
 class AbstractDistanceEstimator {
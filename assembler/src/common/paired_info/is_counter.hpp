@@ -12,11 +12,88 @@
 #include "paired_info/insert_size_refiner.hpp"
 #include "modules/alignment/sequence_mapper_notifier.hpp"
 
+#include <boost/math/distributions/normal.hpp>
+
 namespace debruijn_graph {
 
 using namespace omnigraph;
 
 class InsertSizeCounter: public SequenceMapperListener {
+    // Insert size histogram, reasonable sizes are counted in the flat array
+    class FlatHist {
+        static const size_t MaxFlatSize = 1 << 16;
+
+    public:
+        FlatHist()
+                : total_(0) {}
+
+        void add(int is, size_t count = 1) {
+            total_ += count;
+            if (is < 0 || size_t(is) >= MaxFlatSize) {
+                rest_[is] += count;
+                return;
+            }
+            if (size_t(is) >= flat_.size())
+                flat_.resize(size_t(is) + 1, 0);
+            flat_[is] += count;
+        }
+
+        // Moves all the counts of the other histogram here
+        void merge(FlatHist& other) {
+            if (flat_.size() < other.flat_.size())
+                flat_.resize(other.flat_.size(), 0);
+            for (size_t i = 0; i < other.flat_.size(); ++i)
+                flat_[i] += other.flat_[i];
+            for (const auto& kv : other.rest_)
+                rest_[kv.first] += kv.second;
+            total_ += other.total_;
+            other.clear();
+        }
+
+        void clear() {
+            std::fill(flat_.begin(), flat_.end(), 0);
+            rest_.clear();
+            total_ = 0;
+        }
+
+        size_t total() const { return total_; }
+
+        // Calls f(is, count) for all the sizes in increasing order
+        template<class F>
+        void for_each(F f) const {
+            auto it = rest_.begin();
+            for (; it != rest_.end() && it->first < 0; ++it)
+                f(it->first, it->second);
+            for (size_t i = 0; i < flat_.size(); ++i)
+                if (flat_[i])
+                    f(int(i), flat_[i]);
+            for (; it != rest_.end(); ++it)
+                f(it->first, it->second);
+        }
+
+        // Size at the given position of the sorted sample
+        int at(size_t rank) const {
+            int res = 0;
+            size_t seen = 0;
+            for_each([&](int is, size_t count) {
+                if (seen <= rank)
+                    res = is;
+                seen += count;
+            });
+            return res;
+        }
+
+        HistType hist() const {
+            HistType res;
+            for_each([&](int is, size_t count) { res[is] = count; });
+            return res;
+        }
+
+    private:
+        std::vector<size_t> flat_;
+        HistType rest_;
+        size_t total_;
+    };
 
 public:
 
@@ -25,10 +102,22 @@ public:
             bool ignore_negative = false)
         : gp_(gp), 
           edge_length_threshold_(edge_length_threshold),
-          ignore_negative_(ignore_negative) {
+          ignore_negative_(ignore_negative),
+          early_stop_pairs_(0), z_(0) {
+    }
+
+    /**
+     * @brief Allows to stop processing the library once at least min_pairs pairs are aligned
+     *        and the confidence interval of the median insert size for the given confidence
+     *        level is narrow enough (1bp or 0.1% of the median).
+     */
+    void EnableEarlyStop(size_t min_pairs, double confidence) {
+        VERIFY(confidence > 0 && confidence < 1);
+        early_stop_pairs_ = min_pairs;
+        z_ = boost::math::quantile(boost::math::normal(), (1 + confidence) / 2);
     }
 
-    HistType hist() { return hist_; }
+    HistType hist() { return hist_.hist(); }
     size_t total() const { return total_.total_; }
     size_t mapped() const { return counted_.total_; }
     size_t negative() const { return negative_.total_; }
@@ -36,7 +125,7 @@ public:
 
     void StartProcessLibrary(size_t threads_count) override {
         hist_.clear();
-        tmp_hists_ = vector<HistType>(threads_count);
+        tmp_hists_ = vector<FlatHist>(threads_count);
 
         total_ = count_data(threads_count);
         counted_ = count_data(threads_count);
@@ -67,18 +156,28 @@ public:
     }
 
     void MergeBuffer(size_t thread_index) override {
-        for (const auto& kv: tmp_hists_[thread_index])
-            hist_[kv.first] += kv.second;
+        hist_.merge(tmp_hists_[thread_index]);
+    }
 
-        tmp_hists_[thread_index].clear();
+    bool Saturated() const override {
+        size_t n = hist_.total();
+        if (early_stop_pairs_ == 0 || n < early_stop_pairs_)
+            return false;
+
+        // Distribution-free confidence interval of the median: the sizes
+        // at ranks n/2 -+ z * sqrt(n) / 2 of the sorted sample
+        double half_width = z_ * std::sqrt((double) n) / 2;
+        int low = hist_.at(size_t(std::max(0., (double) n / 2 - half_width)));
+        int high = hist_.at(std::min(n - 1, size_t((double) n / 2 + half_width)));
+        return high - low <= std::max(1, std::abs(low) / 1000);
     }
 
     void FindMean(double& mean, double& delta, std::map<size_t, size_t>& percentiles) const {
-        find_mean(hist_, mean, delta, percentiles);
+        find_mean(hist_.hist(), mean, delta, percentiles);
     }
 
     void FindMedian(double& median, double& mad, HistType& histogram) const {
-        find_median(hist_, median, mad, histogram);
+        find_median(hist_.hist(), median, mad, histogram);
     }
 
 private:
@@ -104,7 +203,7 @@ private:
             TRACE("IS: " << read2_start << " - " <<  read1_start << " + " << (int) is_delta << " = " << is);
 
             if (is > 0 || ignore_negative_) {
-                tmp_hists_[thread_index][is] += 1;
+                tmp_hists_[thread_index].add(is);
                 ++counted_.arr_[thread_index];
             } else {
                 ++negative_.arr_[thread_index];
@@ -133,8 +232,8 @@ private:
 private:
     const conj_graph_pack &gp_;
 
-    HistType hist_;
-    vector<HistType> tmp_hists_;
+    FlatHist hist_;
+    vector<FlatHist> tmp_hists_;
 
     count_data total_;
     count_data counted_;
@@ -142,6 +241,8 @@ private:
 
     size_t edge_length_threshold_;
     bool ignore_negative_;
+    size_t early_stop_pairs_;
+    double z_;
 };
 
 }
@@ -155,6 +155,7 @@ void load(debruijn_config::simplification::tip_clipper &tc,
           boost::property_tree::ptree const &pt, bool complete) {
     using config_common::load;
     load(tc.condition, pt, "condition", complete);
+    load(tc.parallel, pt, "parallel", complete);
 }
 
 void load(debruijn_config::simplification::dead_end_clipper& dead_end,
@@ -306,10 +307,11 @@ void load(debruijn_config::simplification::complex_bulge_remover& cbr,
 }
 
 void load(debruijn_config::simplification::erroneous_connections_remover& ec,
-          boost::property_tree::ptree const& pt, bool /*complete*/) {
+          boost::property_tree::ptree const& pt, bool complete) {
   using config_common::load;
 
   load(ec.condition, pt, "condition");
+  load(ec.parallel, pt, "parallel", complete);
 }
 
 void load(debruijn_config::simplification::relative_coverage_ec_remover& rcec,
@@ -385,6 +387,8 @@ void load(debruijn_config::distance_estimator& de,
   load(de.raw_filter_threshold, pt, "raw_filter_threshold", complete);
   load(de.rounding_coeff, pt, "rounding_coeff", complete);
   load(de.rounding_thr, pt, "rounding_threshold", complete);
+  load(de.is_early_stop_pairs, pt, "is_early_stop_pairs", false);
+  load(de.is_confidence, pt, "is_confidence", false);
 }
 
 void load(debruijn_config::smoothing_distance_estimator& ade,
@@ -568,6 +572,7 @@ void load(debruijn_config::simplification& simp,
   using config_common::load;
 
   load(simp.cycle_iter_count, pt, "cycle_iter_count", complete);
+  load(simp.parallel_batch, pt, "parallel_batch", complete);
 
   load(simp.topology_simplif_enabled, pt, "topology_simplif_enabled", complete);
   load(simp.tc, pt, "tc", complete); // tip clipper:
@@ -724,6 +729,8 @@ void load_cfg(debruijn_config &cfg, boost::property_tree::ptree const &pt,
     load(cfg.single_reads_rr, pt, "single_reads_rr", complete);
 
     load(cfg.preserve_raw_paired_index, pt, "preserve_raw_paired_index", complete);
+    // optional, disabled unless requested
+    load(cfg.mapping_cache, pt, "mapping_cache", false);
 
     load(cfg.correct_mismatches, pt, "correct_mismatches", complete);
     load(cfg.paired_info_statistics, pt, "paired_info_statistics", complete);
@@ -170,12 +170,14 @@ struct debruijn_config {
     bool developer_mode;
 
     bool preserve_raw_paired_index;
+    bool mapping_cache;
 
     struct simplification {
         struct tip_clipper {
             std::string condition;
-            tip_clipper() {}
-            tip_clipper(std::string condition_) : condition(condition_) {}
+            bool parallel;
+            tip_clipper() : parallel(false) {}
+            tip_clipper(std::string condition_) : condition(condition_), parallel(false) {}
         };
 
         struct dead_end_clipper {
@@ -215,8 +217,9 @@ struct debruijn_config {
 
         struct erroneous_connections_remover {
             std::string condition;
-            erroneous_connections_remover() {}
-            erroneous_connections_remover(std::string condition_) : condition(condition_) {}
+            bool parallel;
+            erroneous_connections_remover() : parallel(false) {}
+            erroneous_connections_remover(std::string condition_) : condition(condition_), parallel(false) {}
         };
 
         struct relative_coverage_ec_remover {
@@ -307,6 +310,7 @@ struct debruijn_config {
         };
 
         size_t cycle_iter_count;
+        size_t parallel_batch;
 
         bool topology_simplif_enabled;
         tip_clipper tc;
@@ -362,6 +366,13 @@ struct debruijn_config {
         unsigned raw_filter_threshold;
         double rounding_thr;
         double rounding_coeff;
+        // Insert size estimation may stop after this number of aligned pairs
+        // once the median is known with the given confidence (0 disables)
+        size_t is_early_stop_pairs;
+        double is_confidence;
+
+        distance_estimator()
+                : is_early_stop_pairs(0), is_confidence(0.999) {}
     };
 
     struct smoothing_distance_estimator {
@@ -554,6 +565,7 @@ struct debruijn_config {
     bool need_mapping;
 
     debruijn_config() :
+            mapping_cache(false),
             use_single_reads(false) {
 
     }
@@ -12,6 +12,7 @@
 #include "sequence/genome_storage.hpp"
 #include "assembly_graph/handlers/id_track_handler.hpp"
 #include "assembly_graph/handlers/edges_position_handler.hpp"
+#include "assembly_graph/handlers/content_hash_handler.hpp"
 #include "assembly_graph/core/graph.hpp"
 #include "paired_info/paired_info.hpp"
 #include "pipeline/config_struct.hpp"
@@ -42,8 +43,12 @@ struct graph_pack: private boost::noncopyable {
 
     size_t k_value;
     std::string workdir;
+    // Directory for the on-disk read mapping caches, empty if caching is disabled
+    std::string mapping_cache_dir;
 
     graph_t g;
+    // Always attached, identifies the graph for the read mapping caches
+    omnigraph::GraphContentHash<graph_t> content_hash;
     index_t index;
     KmerMapper<graph_t> kmer_mapper;
     FlankingCoverage<graph_t> flanking_cov;
@@ -68,7 +73,7 @@ struct graph_pack: private boost::noncopyable {
                size_t max_gap_diff = 0,
                bool detach_indices = true)
             : k_value(k), workdir(workdir),
-              g(k), index(g, workdir),
+              g(k), content_hash(g), index(g, workdir),
               kmer_mapper(g),
               flanking_cov(g, flanking_range),
               paired_indices(g, lib_count),
@@ -22,12 +22,15 @@
 
 #include "assembly_graph/core/order_and_law.hpp"
 
+#include "io/kmers/mmapped_reader.hpp"
+
 #include <cmath>
 #include <set>
 #include <map>
 #include <algorithm>
 #include <fstream>
 #include <cstdio>
+#include <cstring>
 
 namespace debruijn_graph {
 
@@ -155,6 +158,73 @@ inline void DeserializePoint(FILE* file, size_t& e1, size_t& e2, Point &p) {
 }
 
 
+// Binary checkpoints (.bgr for graph + sequences + coverage, .bprd for paired info)
+// are versioned and laid out as plain records, so that they can be mmap'ed on load.
+// Text saves are still readable and writable as a debug export.
+static const uint32_t BINARY_SAVES_MAGIC = 0x53475053; // "SPGS"
+static const uint32_t BINARY_SAVES_VERSION = 1;
+
+struct BinaryVertexRecord {
+    uint64_t id;
+    uint64_t conjugate;
+};
+
+// Followed by edge sequence as written by Sequence::BinWrite (2-bit packed)
+struct BinaryEdgeRecord {
+    uint64_t id;
+    uint64_t start;
+    uint64_t end;
+    uint64_t conjugate;
+    uint64_t raw_coverage;
+};
+
+struct BinaryPairedRecord {
+    uint64_t e1;
+    uint64_t e2;
+    float d;
+    float weight;
+    float var;
+    float reserved;
+};
+
+inline void WriteBinaryHeader(std::ostream &out) {
+    out.write((const char *) &BINARY_SAVES_MAGIC, sizeof(BINARY_SAVES_MAGIC));
+    out.write((const char *) &BINARY_SAVES_VERSION, sizeof(BINARY_SAVES_VERSION));
+}
+
+// Records are not aligned inside the file, so they are copied out of the mapped region
+template<class T>
+T BinaryFetch(MMappedReader &reader) {
+    T res;
+    memcpy(&res, reader.skip(sizeof(T)), sizeof(T));
+    return res;
+}
+
+inline void ReadBinaryHeader(MMappedReader &reader, const std::string &file_name) {
+    VERIFY_MSG(reader.size() >= 2 * sizeof(uint32_t), "Truncated binary save " << file_name);
+    uint32_t magic = BinaryFetch<uint32_t>(reader);
+    uint32_t version = BinaryFetch<uint32_t>(reader);
+    VERIFY_MSG(magic == BINARY_SAVES_MAGIC, "File " << file_name << " is not a binary save");
+    VERIFY_MSG(version == BINARY_SAVES_VERSION,
+               "Unsupported binary save version " << version << " in " << file_name);
+}
+
+inline BinaryPairedRecord ToBinaryRecord(size_t e1, size_t e2, const RawPoint &p) {
+    return { e1, e2, (float) p.d, (float) p.weight, 0.f, 0.f };
+}
+
+inline BinaryPairedRecord ToBinaryRecord(size_t e1, size_t e2, const Point &p) {
+    return { e1, e2, (float) p.d, (float) p.weight, (float) p.var, 0.f };
+}
+
+inline void FromBinaryRecord(const BinaryPairedRecord &r, RawPoint &p) {
+    p = RawPoint(r.d, r.weight);
+}
+
+inline void FromBinaryRecord(const BinaryPairedRecord &r, Point &p) {
+    p = Point(r.d, r.weight, r.var);
+}
+
 template<class Graph>
 class DataPrinter {
     typedef typename Graph::EdgeId EdgeId;
@@ -188,6 +258,8 @@ class DataPrinter {
   public:
 
     void SaveGraph(const string& file_name) const {
+        // Binary saves take precedence on load, so drop the stale one
+        fs::remove_if_exists(file_name + ".bgr");
         FILE* gid_file = fopen((file_name + ".gid").c_str(), "w");
         size_t max_id = this->component().g().GetGraphIdDistributor().GetMax();
         fprintf(gid_file, "%zu\n", max_id);
@@ -247,6 +319,7 @@ class DataPrinter {
     template<class Index>
     void SavePaired(const string& file_name,
                     Index const& paired_index) const {
+        fs::remove_if_exists(file_name + ".bprd");
         FILE* file = fopen((file_name + ".prd").c_str(), "w");
         DEBUG("Saving paired info, " << file_name <<" created");
         VERIFY(file != NULL);
@@ -280,6 +353,40 @@ class DataPrinter {
         fclose(file);
     }
 
+    template<class Index>
+    void SaveBinaryPaired(const string& file_name,
+                          Index const& paired_index) const {
+        std::ofstream out(file_name + ".bprd", std::ios_base::binary | std::ios_base::out);
+        DEBUG("Saving binary paired info, " << file_name <<" created");
+        VERIFY_MSG(out.is_open(), "Couldn't open file " << (file_name + ".bprd") << " on write");
+
+        WriteBinaryHeader(out);
+        // Placeholder for the record count, patched at the end
+        uint64_t comp_size = 0;
+        std::streampos count_pos = out.tellp();
+        out.write((const char *) &comp_size, sizeof(comp_size));
+
+        for (auto I = component_.e_begin(), E = component_.e_end(); I != E; ++I) {
+            EdgeId e1 = *I;
+            const auto& inner_map = paired_index.GetHalf(e1);
+            std::map<typename Graph::EdgeId, typename Index::HistProxy> ordermap(inner_map.begin(), inner_map.end());
+            for (auto entry : ordermap) {
+                EdgeId e2 = entry.first;
+                if (!component_.contains(e2))
+                    continue;
+                for (auto point : entry.second) {
+                    BinaryPairedRecord r = ToBinaryRecord(e1.int_id(), e2.int_id(), point);
+                    out.write((const char *) &r, sizeof(r));
+                    comp_size += 1;
+                }
+            }
+        }
+
+        out.seekp(count_pos);
+        out.write((const char *) &comp_size, sizeof(comp_size));
+        VERIFY_MSG(!out.fail(), "Failed to write " << (file_name + ".bprd"));
+    }
+
     void SavePositions(const string& file_name,
                        EdgesPositionHandler<Graph> const& ref_pos) const {
         ofstream file((file_name + ".pos").c_str());
@@ -374,6 +481,34 @@ class ConjugateDataPrinter: public DataPrinter<Graph> {
         return ss.str();
     }
 
+    void SaveBinaryGraph(const string& file_name) const {
+        const Graph &g = this->component().g();
+        std::ofstream out(file_name + ".bgr", std::ios_base::binary | std::ios_base::out);
+        DEBUG("Binary graph saving to " << file_name << " started");
+        VERIFY_MSG(out.is_open(), "Couldn't open file " << (file_name + ".bgr") << " on write");
+
+        WriteBinaryHeader(out);
+        uint64_t sizes[3] = { g.GetGraphIdDistributor().GetMax(),
+                              this->component().v_size(), this->component().e_size() };
+        out.write((const char *) sizes, sizeof(sizes));
+
+        for (auto it = this->component().v_begin(); it != this->component().v_end(); ++it) {
+            VertexId v = *it;
+            BinaryVertexRecord r = { v.int_id(), g.conjugate(v).int_id() };
+            out.write((const char *) &r, sizeof(r));
+        }
+
+        for (auto it = this->component().e_begin(); it != this->component().e_end(); ++it) {
+            EdgeId e = *it;
+            BinaryEdgeRecord r = { e.int_id(), g.EdgeStart(e).int_id(), g.EdgeEnd(e).int_id(),
+                                   g.conjugate(e).int_id(), g.coverage_index().RawCoverage(e) };
+            out.write((const char *) &r, sizeof(r));
+            g.EdgeNucls(e).BinWrite(out);
+        }
+
+        VERIFY_MSG(!out.fail(), "Failed to write " << (file_name + ".bgr"));
+        DEBUG("Binary graph saving to " << file_name << " finished");
+    }
 };
 
 template<class Graph>
@@ -417,6 +552,14 @@ class DataScanner {
   public:
     virtual void LoadGraph(const string& file_name) = 0;
 
+    /**
+     * Loads graph together with edge sequences and coverage from the binary checkpoint.
+     * @return false if there is no binary checkpoint for the file_name
+     */
+    virtual bool LoadBinaryGraph(const string& /*file_name*/) {
+        return false;
+    }
+
     void LoadCoverage(const string& file_name) {
         INFO("Reading coverage from " << file_name);
         ifstream in(file_name + ".cvr");
@@ -453,6 +596,9 @@ class DataScanner {
                     Index& paired_index,
                     bool force_exists = true) {
         typedef typename Graph::EdgeId EdgeId;
+        if (LoadBinaryPaired(file_name, paired_index))
+            return;
+
         FILE* file = fopen((file_name + ".prd").c_str(), "r");
         INFO((file_name + ".prd"));
         if (force_exists) {
@@ -490,6 +636,42 @@ class DataScanner {
         fclose(file);
     }
 
+    template<typename Index>
+    bool LoadBinaryPaired(const string& file_name,
+                          Index& paired_index) {
+        std::string bin_name = file_name + ".bprd";
+        if (!fs::FileExists(bin_name))
+            return false;
+        INFO("Reading binary paired info from " << file_name << " started");
+
+        MMappedReader reader(bin_name, /*unlink*/ false, /*blocksize*/ -1ULL);
+        ReadBinaryHeader(reader, bin_name);
+        uint64_t paired_count = BinaryFetch<uint64_t>(reader);
+        VERIFY_MSG(reader.size() == 2 * sizeof(uint32_t) + sizeof(uint64_t) + paired_count * sizeof(BinaryPairedRecord),
+                   "Truncated binary save " << bin_name);
+        if (!paired_count)
+            return true;
+
+        for (size_t i = 0; i < paired_count; ++i) {
+            BinaryPairedRecord r = BinaryFetch<BinaryPairedRecord>(reader);
+            typename Index::Point point;
+            FromBinaryRecord(r, point);
+
+            VERIFY(this->edge_id_map().find(r.e1) != this->edge_id_map().end());
+            EdgeId e1 = this->edge_id_map()[r.e1];
+            EdgeId e2 = this->edge_id_map()[r.e2];
+            if (e1 == EdgeId() || e2 == EdgeId())
+                continue;
+            //Need to prevent doubling of self-conjugate edge pairs
+            auto ep = std::make_pair(e1, e2);
+            if (ep == paired_index.ConjugatePair(ep))
+                point.weight = math::round(point.weight / 2);
+            paired_index.Add(e1, e2, point);
+        }
+        DEBUG("PII SIZE " << paired_index.size());
+        return true;
+    }
+
     bool LoadPositions(const string& file_name,
                        EdgesPositionHandler<Graph>& edge_pos) {
         FILE* file = fopen((file_name + ".pos").c_str(), "r");
@@ -664,6 +846,53 @@ private:
         fclose(file);
         fclose(sequence_file);
     }
+
+    /*virtual*/
+    bool LoadBinaryGraph(const string& file_name) {
+        std::string bin_name = file_name + ".bgr";
+        if (!fs::FileExists(bin_name))
+            return false;
+        INFO("Reading conjugate de bruijn graph from binary save " << bin_name << " started");
+
+        MMappedReader reader(bin_name, /*unlink*/ false, /*blocksize*/ -1ULL);
+        ReadBinaryHeader(reader, bin_name);
+        uint64_t max_id = BinaryFetch<uint64_t>(reader);
+        uint64_t vertex_count = BinaryFetch<uint64_t>(reader);
+        uint64_t edge_count = BinaryFetch<uint64_t>(reader);
+
+        auto id_storage = this->g().GetGraphIdDistributor().Reserve(max_id, /*force_zero_shift*/true);
+        for (size_t i = 0; i < vertex_count; ++i) {
+            BinaryVertexRecord r = BinaryFetch<BinaryVertexRecord>(reader);
+            if (this->vertex_id_map().find(r.id) != this->vertex_id_map().end())
+                continue;
+
+            size_t ids[2] = {r.id, r.conjugate};
+            auto id_distributor = id_storage.GetSegmentIdDistributor(ids, ids + 2);
+            VertexId vid = this->g().AddVertex(typename Graph::VertexData(), id_distributor);
+            this->vertex_id_map()[r.id] = vid;
+            this->vertex_id_map()[r.conjugate] = this->g().conjugate(vid);
+        }
+
+        for (size_t i = 0; i < edge_count; ++i) {
+            BinaryEdgeRecord r = BinaryFetch<BinaryEdgeRecord>(reader);
+            size_t length = BinaryFetch<size_t>(reader);
+            const seq_element_type *packed =
+                    (const seq_element_type *) reader.skip(Sequence::PackedSize(length));
+            if (this->edge_id_map().find(r.id) == this->edge_id_map().end()) {
+                size_t ids[2] = {r.id, r.conjugate};
+                auto id_distributor = id_storage.GetSegmentIdDistributor(ids, ids + 2);
+                EdgeId eid = this->g().AddEdge(this->vertex_id_map()[r.start], this->vertex_id_map()[r.end],
+                                               Sequence(length, packed), id_distributor);
+                this->edge_id_map()[r.id] = eid;
+                this->edge_id_map()[r.conjugate] = this->g().conjugate(eid);
+            }
+            this->g().coverage_index().SetRawCoverage(this->edge_id_map()[r.id], (unsigned) r.raw_coverage);
+        }
+        VERIFY_MSG(!reader.good(), "Garbage at the end of binary save " << bin_name);
+
+        return true;
+    }
+
   public:
     ConjugateDataScanner(Graph& g) :
             base(g) {
@@ -686,10 +915,9 @@ void PrintBasicGraph(const std::string& file_name, DataPrinter<Graph>& printer)
 }
 
 template<class graph_pack>
-void PrintGraphPack(const std::string& file_name,
-                    DataPrinter<typename graph_pack::graph_t>& printer,
-                    const graph_pack& gp) {
-    PrintBasicGraph(file_name, printer);
+void PrintGraphPackAttachments(const std::string& file_name,
+                               DataPrinter<typename graph_pack::graph_t>& printer,
+                               const graph_pack& gp) {
     //  printer.SavePaired(file_name + "_et", gp.etalon_paired_index);
     if (gp.edge_pos.IsAttached())
         printer.SavePositions(file_name, gp.edge_pos);
@@ -700,7 +928,14 @@ void PrintGraphPack(const std::string& file_name,
     if (gp.flanking_cov.IsAttached())
         printer.SaveFlankingCoverage(file_name, gp.flanking_cov);
     printer.SaveSSCoverage(file_name, gp.ss_coverage);
+}
 
+template<class graph_pack>
+void PrintGraphPack(const std::string& file_name,
+                    DataPrinter<typename graph_pack::graph_t>& printer,
+                    const graph_pack& gp) {
+    PrintBasicGraph(file_name, printer);
+    PrintGraphPackAttachments(file_name, printer, gp);
 }
 
 template<class graph_pack>
@@ -811,13 +1046,32 @@ void PrintSingleLongReads(const string& file_name, const LongReadContainer<Graph
     }
 }
 
+template<class Graph, class Indices>
+void PrintBinaryIndices(const string& file_name, const string& suffix,
+                        DataPrinter<Graph>& printer, const Indices& paired_indices) {
+    for (size_t i = 0; i < paired_indices.size(); ++i)
+        printer.SaveBinaryPaired(file_name + "_" + std::to_string(i) + suffix, paired_indices[i]);
+}
+
+/**
+ * Saves the whole graph pack. By default graph and paired indices are written
+ * in binary checkpoint format, text format is intended for debug export.
+ */
 template<class graph_pack>
-void PrintAll(const string& file_name, const graph_pack& gp) {
+void PrintAll(const string& file_name, const graph_pack& gp, bool binary = true) {
     ConjugateDataPrinter<typename graph_pack::graph_t> printer(gp.g, gp.g.begin(), gp.g.end());
-    PrintGraphPack(file_name, printer, gp);
-    PrintUnclusteredIndices(file_name, printer, gp.paired_indices);
-    PrintClusteredIndices(file_name, printer, gp.clustered_indices);
-    PrintScaffoldingIndices(file_name, printer, gp.scaffolding_indices);
+    if (binary) {
+        printer.SaveBinaryGraph(file_name);
+        PrintGraphPackAttachments(file_name, printer, gp);
+        PrintBinaryIndices(file_name, "", printer, gp.paired_indices);
+        PrintBinaryIndices(file_name, "_cl", printer, gp.clustered_indices);
+        PrintBinaryIndices(file_name, "_scf", printer, gp.scaffolding_indices);
+    } else {
+        PrintGraphPack(file_name, printer, gp);
+        PrintUnclusteredIndices(file_name, printer, gp.paired_indices);
+        PrintClusteredIndices(file_name, printer, gp.clustered_indices);
+        PrintScaffoldingIndices(file_name, printer, gp.scaffolding_indices);
+    }
     PrintSingleLongReads(file_name, gp.single_long_reads);
     gp.ginfo.Save(file_name + ".ginfo");
 }
@@ -881,6 +1135,8 @@ void PrintWithClusteredIndices(const string& file_name, const graph_pack& gp,
 
 template<class Graph>
 void ScanBasicGraph(const string& file_name, DataScanner<Graph>& scanner) {
+    if (scanner.LoadBinaryGraph(file_name))
+        return;
     scanner.LoadGraph(file_name);
     scanner.LoadCoverage(file_name);
 }
@@ -9,6 +9,7 @@
 #include "pipeline/graphio.hpp"
 
 #include "utils/logger/log_writers.hpp"
+#include "utils/perf/stage_profiler.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -99,7 +100,10 @@ void CompositeStageBase::run(debruijn_graph::conj_graph_pack& gp,
         PhaseBase *phase = start_phase->get();
 
         INFO("PROCEDURE == " << phase->name());
-        phase->run(gp, started_from);
+        {
+            utils::ProfiledScope profile(phase->name());
+            phase->run(gp, started_from);
+        }
 
         if (parent_->saves_policy().make_saves_) {
             std::string composite_id(id());
@@ -130,7 +134,11 @@ void StageManager::run(debruijn_graph::conj_graph_pack& g,
         AssemblyStage *stage = start_stage->get();
 
         INFO("STAGE == " << stage->name());
-        stage->run(g, start_from);
+        {
+            utils::ProfiledScope profile(stage->name());
+            stage->run(g, start_from);
+        }
+        utils::stage_profiler().Flush();
         if (saves_policy_.make_saves_)
             stage->save(g, saves_policy_.save_to_);
     }
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <memory>
@@ -32,16 +33,20 @@ class Sequence {
                                     protected llvm::TrailingObjects<ManagedNuclBuffer, ST> {
         friend TrailingObjects;
 
-        ManagedNuclBuffer() {}
+        size_t nucls_;
 
-        ManagedNuclBuffer(size_t nucls, ST *buf) {
+        ManagedNuclBuffer(size_t nucls)
+                : nucls_(nucls) {}
+
+        ManagedNuclBuffer(size_t nucls, ST *buf)
+                : nucls_(nucls) {
             std::uninitialized_copy(buf, buf + Sequence::DataSize(nucls), data());
         }
 
       public:
         static ManagedNuclBuffer *create(size_t nucls) {
             void *mem = ::operator new(totalSizeToAlloc<ST>(Sequence::DataSize(nucls)));
-            return new (mem) ManagedNuclBuffer();
+            return new (mem) ManagedNuclBuffer(nucls);
         }
 
         static ManagedNuclBuffer *create(size_t nucls, ST *data) {
@@ -51,6 +56,7 @@ class Sequence {
 
         const ST *data() const { return getTrailingObjects<ST>(); }
         ST *data() { return getTrailingObjects<ST>(); }
+        size_t nucls() const { return nucls_; }
     };
 
     size_t from_;
@@ -269,6 +275,28 @@ public:
         return size() == 0;
     }
 
+    /**
+     * @return identity of the underlying nucleotide buffer. Sequences obtained via
+     * Subseq / operator! share the buffer with the original one.
+     */
+    const void *buffer_id() const {
+        return data_.get();
+    }
+
+    /**
+     * @return number of nucleotides the underlying buffer is able to hold
+     */
+    size_t buffer_capacity() const {
+        return data_->nucls();
+    }
+
+    /**
+     * Packs the sequences one after another into shared buffers ("arenas") of
+     * about arena_size nucleotides. Every sequence is replaced with the view
+     * into the arena, so the separate per-sequence buffers are released.
+     */
+    static inline void Pack(std::vector<Sequence> &seqs, size_t arena_size = 1 << 20);
+
     template<class Seq>
     bool contains(const Seq& s, size_t offset = 0) const {
         VERIFY_DEV(offset + s.size() <= size());
@@ -283,6 +311,31 @@ public:
 public:
     inline bool BinRead(std::istream &file);
     inline bool BinWrite(std::ostream &file) const;
+
+    /**
+     * Reads the sequence from the memory buffer (in the same format as BinWrite writes it)
+     *
+     * @return pointer right past the record
+     */
+    inline const uint8_t *BinRead(const uint8_t *data);
+
+    /**
+     * Sequence initialization from the packed nucleotide buffer (in the same format as BinWrite writes it)
+     *
+     * @param size number of nucleotides
+     * @param packed buffer of PackedSize(size) bytes
+     */
+    Sequence(size_t size, const seq_element_type *packed)
+            : Sequence(size, 0) {
+        memcpy(data_->data(), packed, DataSize(size_) * sizeof(ST));
+    }
+
+    /**
+     * @return size (in bytes) of the packed representation of size nucleotides
+     */
+    static size_t PackedSize(size_t size) {
+        return DataSize(size) * sizeof(ST);
+    }
 };
 
 inline std::ostream &operator<<(std::ostream &os, const Sequence &s);
@@ -419,6 +472,42 @@ bool Sequence::BinRead(std::istream &file) {
 }
 
 
+void Sequence::Pack(std::vector<Sequence> &seqs, size_t arena_size) {
+    for (size_t start = 0; start < seqs.size(); ) {
+        size_t end = start, total = 0;
+        while (end < seqs.size() && (end == start || total + seqs[end].size() <= arena_size))
+            total += seqs[end++].size();
+
+        Sequence arena(total, 0);
+        ST *bytes = arena.data_->data();
+        std::fill(bytes, bytes + DataSize(total), ST(0));
+
+        size_t pos = 0;
+        for (size_t i = start; i < end; ++i) {
+            size_t from = pos, sz = seqs[i].size();
+            const Sequence &s = seqs[i];
+            for (size_t j = 0; j < sz; ++j, ++pos)
+                bytes[pos >> STNBits] |= ST(s[j]) << ((pos & (STN - 1)) << 1);
+
+            seqs[i] = Sequence(arena, from, sz, false);
+        }
+
+        start = end;
+    }
+}
+
+const uint8_t *Sequence::BinRead(const uint8_t *data) {
+    memcpy(&size_, data, sizeof(size_));
+    data += sizeof(size_);
+    from_ = 0;
+    rtl_ = false;
+
+    data_ = llvm::IntrusiveRefCntPtr<ManagedNuclBuffer>(ManagedNuclBuffer::create(size_));
+    memcpy(data_->data(), data, DataSize(size_) * sizeof(ST));
+
+    return data + DataSize(size_) * sizeof(ST);
+}
+
 bool Sequence::BinWrite(std::ostream &file) const {
     if (from_ != 0 || rtl_) {
         Sequence clear(this->str());
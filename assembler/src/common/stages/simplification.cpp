@@ -34,7 +34,8 @@ SimplifInfoContainer CreateInfoContainer(const conj_graph_pack &gp) {
     SimplifInfoContainer info_container(cfg::get().mode);
     info_container.set_read_length(cfg::get().ds.RL)
             .set_main_iteration(cfg::get().main_iteration)
-            .set_chunk_cnt(5 * cfg::get().max_threads);
+            .set_chunk_cnt(5 * cfg::get().max_threads)
+            .set_parallel_batch(cfg::get().simp.parallel_batch);
 
     //0 if model didn't converge
     //todo take max with trusted_bound
@@ -419,6 +420,9 @@ void RawSimplification::run(conj_graph_pack &gp, const char*) {
                                nullptr/*removal_handler_f*/,
                                printer);
     simplifier.InitialCleaning();
+
+    size_t repacked = gp.g.CompactEdgeSequences();
+    INFO("Repacked " << repacked << " nucleotides of edge sequences");
 }
 
 void Simplification::run(conj_graph_pack &gp, const char*) {
@@ -452,6 +456,9 @@ void Simplification::run(conj_graph_pack &gp, const char*) {
                                printer);
 
     simplifier.SimplifyGraph();
+
+    size_t repacked = gp.g.CompactEdgeSequences();
+    INFO("Repacked " << repacked << " nucleotides of edge sequences");
 }
 
 void SimplificationCleanup::run(conj_graph_pack &gp, const char*) {
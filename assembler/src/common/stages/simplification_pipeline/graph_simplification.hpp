@@ -342,6 +342,10 @@ protected:
         return proceed_condition_(e);
     }
 
+    bool Check(EdgeId e) const override {
+        return remove_condition_(e);
+    }
+
     bool Process(EdgeId e) override {
         TRACE("Checking edge " << this->g().str(e) << " for the removal condition");
         if (remove_condition_(e)) {
@@ -555,8 +559,11 @@ AlgoPtr<Graph> ECRemoverInstance(Graph &g,
     if (ec_config.condition.empty())
         return nullptr;
 
-    return std::make_shared<LowCoverageEdgeRemovingAlgorithm<Graph>>(
+    auto algo = std::make_shared<LowCoverageEdgeRemovingAlgorithm<Graph>>(
             g, ec_config.condition, info, removal_handler);
+    if (ec_config.parallel)
+        algo->EnableParallelProcessing(info.parallel_batch());
+    return algo;
 }
 
 template<class Graph>
@@ -564,14 +571,18 @@ AlgoPtr<Graph> TipClipperInstance(Graph &g,
                                   const EdgeConditionT<Graph> &condition,
                                   const SimplifInfoContainer &info,
                                   EdgeRemovalHandlerF<Graph> removal_handler = nullptr,
-                                  bool track_changes = true) {
-    return make_shared<omnigraph::ParallelEdgeRemovingAlgorithm<Graph, omnigraph::LengthComparator<Graph>>>(g,
+                                  bool track_changes = true,
+                                  bool parallel = false) {
+    auto algo = make_shared<omnigraph::ParallelEdgeRemovingAlgorithm<Graph, omnigraph::LengthComparator<Graph>>>(g,
                                                                         AddTipCondition(g, condition),
                                                                         info.chunk_cnt(),
                                                                         removal_handler,
                                                                         /*canonical_only*/true,
                                                                         LengthComparator<Graph>(g),
                                                                         track_changes);
+    if (parallel)
+        algo->EnableParallelProcessing(info.parallel_batch());
+    return algo;
 }
 
 template<class Graph>
@@ -584,7 +595,8 @@ AlgoPtr<Graph> TipClipperInstance(Graph &g,
 
     ConditionParser<Graph> parser(g, tc_config.condition, info);
     auto condition = parser();
-    auto algo = TipClipperInstance(g, condition, info, removal_handler);
+    auto algo = TipClipperInstance(g, condition, info, removal_handler,
+                                   /*track_changes*/true, tc_config.parallel);
     VERIFY_MSG(parser.requested_iterations() != 0, "To disable tip clipper pass empty string");
     if (parser.requested_iterations() == 1) {
         return algo;
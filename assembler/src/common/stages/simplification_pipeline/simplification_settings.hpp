@@ -41,6 +41,7 @@ class SimplifInfoContainer {
     double detected_coverage_bound_;
     bool main_iteration_;
     size_t chunk_cnt_;
+    size_t parallel_batch_;
     debruijn_graph::config::pipeline_type mode_;
 
 public: 
@@ -50,6 +51,7 @@ public:
         detected_coverage_bound_(-1.0),
         main_iteration_(false),
         chunk_cnt_(-1ul),
+        parallel_batch_(10000),
         mode_(mode) {
     }
 
@@ -77,6 +79,11 @@ public:
         return chunk_cnt_;
     }
 
+    //number of candidates checked in parallel by the stages running in parallel mode
+    size_t parallel_batch() const {
+        return parallel_batch_;
+    }
+
     debruijn_graph::config::pipeline_type mode() const {
         return mode_;
     }
@@ -105,6 +112,11 @@ public:
         chunk_cnt_ = chunk_cnt;
         return *this;
     }
+
+    SimplifInfoContainer& set_parallel_batch(size_t parallel_batch) {
+        parallel_batch_ = parallel_batch;
+        return *this;
+    }
 };
 
 }
@@ -91,7 +91,7 @@ public:
                          index.k() + 1, Index::storing_type::IsInvertable(), read_buffer_size);
         for (unsigned i = 0; i < counter.num_buckets(); ++i)
             splitter.AddKMers(counter.GetMergedKMersFname(i));
-        KMerDiskCounter<RtSeq> counter2(workdir, splitter);
+        KMerMemoryCounter<RtSeq> counter2(workdir, splitter);
 
         BuildIndex(index, counter2, 16, nthreads);
 
@@ -10,6 +10,7 @@
 
 #include "io/kmers/mmapped_reader.hpp"
 #include "io/kmers/mmapped_writer.hpp"
+#include "io/kmers/async_writer.hpp"
 #include "common/adt/kmer_vector.hpp"
 
 #include "utils/parallel/openmp_wrapper.h"
@@ -66,6 +67,14 @@ public:
 
   virtual std::unique_ptr<RawKMerStorage> GetBucket(size_t idx, bool unlink = true) = 0;
 
+  // In-memory counters keep the buckets in RAM, so they could be accessed
+  // directly without any file backing
+  virtual bool in_memory() const { return false; }
+  virtual adt::iterator_range<iterator> GetBucketRange(size_t) {
+    VERIFY_MSG(false, "k-mer buckets are not kept in memory");
+    return adt::make_range(iterator(nullptr, 0), iterator(nullptr, 0));
+  }
+
   virtual ~KMerCounter() {}
 
   unsigned num_buckets() const { return num_buckets_; }
@@ -117,33 +126,7 @@ public:
     INFO("Splitting kmer instances into " << num_files << " files using " << num_threads << " threads. This might take a while.");
     auto raw_kmers = splitter_.Split(num_files, num_threads);
 
-    INFO("Starting k-mer counting.");
-    size_t kmers = 0;
-#   pragma omp parallel for shared(raw_kmers) num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
-    for (unsigned i = 0; i < raw_kmers.size(); ++i) {
-      kmers += MergeKMers(*raw_kmers[i], GetUniqueKMersFname(i));
-      raw_kmers[i].reset();
-    }
-    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
-    if (!kmers) {
-      FATAL_ERROR("No kmers were extracted from reads. Check the read lengths and k-mer length settings");
-      exit(-1);
-    }
-
-    INFO("Merging temporary buckets.");
-    for (unsigned i = 0; i < num_buckets; ++i) {
-      std::string ofname = GetMergedKMersFname(i);
-      std::ofstream ofs(ofname.c_str(), std::ios::out | std::ios::binary);
-      for (unsigned j = 0; j < num_threads; ++j) {
-        BucketStorage ins(GetUniqueKMersFname(i + j * num_buckets), Seq::GetDataSize(k_), /* unlink */ true);
-        ofs.write((const char*)ins.data(), ins.data_size());
-      }
-    }
-
-    this->kmers_ = kmers;
-    this->counted_ = true;
-
-    return kmers;
+    return CountRaw(raw_kmers, num_buckets, num_threads);
   }
 
   void MergeBuckets() override {
@@ -175,18 +158,46 @@ public:
     return final_kmers_;
   }
 
-private:
+protected:
   fs::TmpDir work_dir_;
   fs::TmpFile kmer_prefix_;
   fs::TmpFile final_kmers_;
-  KMerSplitter<Seq> &splitter_;
-  unsigned k_;
 
-  std::string GetUniqueKMersFname(unsigned suffix) const {
-    return kmer_prefix_->file() + ".unique." + std::to_string(suffix);
+  size_t CountRaw(typename KMerSplitter<Seq>::RawKMers &raw_kmers,
+                  unsigned num_buckets, unsigned num_threads) {
+    // Raw files i, i + num_buckets, ... contain disjoint sets of k-mers (as
+    // they are split by hash), so every merged bucket is written in a single
+    // pass just by appending the unique k-mers of each of them.
+    VERIFY(raw_kmers.size() % num_buckets == 0);
+    unsigned files_per_bucket = unsigned(raw_kmers.size() / num_buckets);
+    INFO("Starting k-mer counting.");
+    size_t kmers = 0;
+#   pragma omp parallel for shared(raw_kmers) num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
+    for (unsigned i = 0; i < num_buckets; ++i) {
+      AsyncBufferedWriter os(GetMergedKMersFname(i));
+      for (unsigned j = 0; j < files_per_bucket; ++j) {
+        unsigned idx = i + j * num_buckets;
+        kmers += MergeKMers(*raw_kmers[idx], os);
+        raw_kmers[idx].reset();
+      }
+    }
+    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
+    if (!kmers) {
+      FATAL_ERROR("No kmers were extracted from reads. Check the read lengths and k-mer length settings");
+      exit(-1);
+    }
+
+    this->kmers_ = kmers;
+    this->counted_ = true;
+
+    return kmers;
   }
 
-  size_t MergeKMers(const std::string &ifname, const std::string &ofname) {
+private:
+  KMerSplitter<Seq> &splitter_;
+  unsigned k_;
+
+  size_t MergeKMers(const std::string &ifname, AsyncBufferedWriter &os) {
     MMappedRecordArrayReader<typename Seq::DataType> ins(ifname, Seq::GetDataSize(k_), /* unlink */ true);
 
     std::string IdxFileName = ifname + ".idx";
@@ -210,50 +221,25 @@ private:
       adt::loser_tree<decltype(beg),
               adt::array_less<typename Seq::DataType>> tree(ranges);
 
-      if (tree.empty()) {
-        FILE *g = fopen(ofname.c_str(), "ab");
-        if (!g)
-          FATAL_ERROR("Cannot open temporary file " << ofname << " for writing");
-        fclose(g);
+      if (tree.empty())
         return 0;
-      }
 
-      // Write it down!
-      adt::KMerVector<Seq> buf(k_, 1024*1024);
+      // Write it down! Writer flushes the buffers in background, so we could
+      // proceed with popping from the tree.
       auto pval = tree.pop();
       size_t total = 0;
       while (!tree.empty()) {
-          buf.clear();
-          for (size_t cnt = 0; cnt < buf.capacity() && !tree.empty(); ) {
-              auto cval = tree.pop();
-              if (!adt::array_equal_to<typename Seq::DataType>()(pval, cval)) {
-                  buf.push_back(pval);
-                  pval = cval;
-                  cnt += 1;
-              }
+          auto cval = tree.pop();
+          if (!adt::array_equal_to<typename Seq::DataType>()(pval, cval)) {
+              os.write(pval.data(), pval.data_size());
+              pval = cval;
+              total += 1;
           }
-          total += buf.size();
-
-          FILE *g = fopen(ofname.c_str(), "ab");
-          if (!g)
-            FATAL_ERROR("Cannot open temporary file " << ofname << " for writing");
-          size_t res = fwrite(buf.data(), buf.el_data_size(), buf.size(), g);
-          if (res != buf.size())
-            FATAL_ERROR("I/O error! Incomplete write! Reason: " << strerror(errno) << ". Error code: " << errno);
-          fclose(g);
       }
 
       // Handle very last value
-      {
-        FILE *g = fopen(ofname.c_str(), "ab");
-        if (!g)
-          FATAL_ERROR("Cannot open temporary file " << ofname << " for writing");
-        size_t res = fwrite(pval.data(), pval.data_size(), 1, g);
-        if (res != 1)
-          FATAL_ERROR("I/O error! Incomplete write! Reason: " << strerror(errno) << ". Error code: " << errno);
-        fclose(g);
-        total += 1;
-      }
+      os.write(pval.data(), pval.data_size());
+      total += 1;
 
       return total;
     } else {
@@ -264,13 +250,123 @@ private:
       // resizing.
       auto it = std::unique(ins.begin(), ins.end(), adt::array_equal_to<typename Seq::DataType>());
 
-      MMappedRecordArrayWriter<typename Seq::DataType> os(ofname, Seq::GetDataSize(k_));
-      os.resize(it - ins.begin());
-      std::copy(ins.begin(), it, os.begin());
+      size_t total = it - ins.begin();
+      os.write(ins.data(), total * kmer_size());
+
+      return total;
+    }
+  }
+};
+
+// Keeps split k-mers in RAM, sorts and deduplicates them in place and hands
+// the buckets to the index builder directly. Falls back to the ordinary disk
+// counting if splitter runs out of the memory budget.
+template<class Seq, class traits = kmer_index_traits<Seq> >
+class KMerMemoryCounter : public KMerDiskCounter<Seq, traits> {
+  typedef KMerDiskCounter<Seq, traits> __super;
+  typedef typename traits::RawKMerStorage BucketStorage;
+  typedef typename KMerCounter<Seq, traits>::iterator iterator;
+public:
+  KMerMemoryCounter(fs::TmpDir work_dir,
+                    KMerSortingSplitter<Seq> &splitter,
+                    size_t memory_budget = 0)
+      : __super(work_dir, splitter), splitter_(splitter),
+        memory_budget_(memory_budget ? memory_budget : utils::get_free_memory() / 2),
+        in_memory_(false) {}
+
+  KMerMemoryCounter(const std::string &work_dir,
+                    KMerSortingSplitter<Seq> &splitter,
+                    size_t memory_budget = 0)
+      : KMerMemoryCounter(fs::tmp::make_temp_dir(work_dir, "kmer_counter"), splitter, memory_budget) {}
+
+  bool in_memory() const override { return in_memory_; }
+
+  adt::iterator_range<iterator> GetBucketRange(size_t idx) override {
+    VERIFY_MSG(this->counted_ && in_memory_, "k-mers were not counted in memory");
+    auto &bucket = buckets_[idx];
+    return adt::make_range(bucket.begin(), bucket.end());
+  }
+
+  std::unique_ptr<BucketStorage> GetBucket(size_t idx, bool unlink = true) override {
+    if (!in_memory_)
+      return __super::GetBucket(idx, unlink);
+
+    // Someone needs a file-backed bucket, dump it
+    std::string fname = this->GetMergedKMersFname((unsigned)idx);
+    {
+      AsyncBufferedWriter os(fname);
+      os.write(buckets_[idx].data(), buckets_[idx].size() * this->kmer_size());
+    }
+    return std::unique_ptr<BucketStorage>(new BucketStorage(fname, Seq::GetDataSize(this->k()), unlink));
+  }
+
+  size_t Count(unsigned num_buckets, unsigned num_threads) override {
+    this->num_buckets_ = num_buckets;
+    in_memory_ = false;
+    buckets_.clear();
+
+    // There is no need to split into per-thread files here, as there are no
+    // merges of the files. Fallback path handles arbitrary number of files per bucket.
+    INFO("Splitting kmer instances into " << num_buckets << " buckets using " << num_threads << " threads. "
+         "Memory budget for in-memory counting: " << memory_budget_ / 1024 / 1024 << " Mb.");
+    splitter_.set_memory_budget(memory_budget_);
+    auto raw_kmers = splitter_.Split(num_buckets, num_threads);
+    splitter_.set_memory_budget(0);
+    if (!splitter_.in_memory()) {
+      INFO("Falling back to on-disk k-mer counting");
+      return this->CountRaw(raw_kmers, num_buckets, num_threads);
+    }
+    raw_kmers.clear();
+
+    INFO("Starting in-memory k-mer counting.");
+    buckets_ = std::move(splitter_.memory_kmers());
+    splitter_.ReleaseMemoryKMers();
+    VERIFY(buckets_.size() == num_buckets);
 
-      return it - ins.begin();
+    size_t kmers = 0;
+#   pragma omp parallel for num_threads(num_threads) schedule(dynamic) reduction(+:kmers)
+    for (unsigned i = 0; i < num_buckets; ++i) {
+      auto &bucket = buckets_[i];
+      libcxx::sort(bucket.begin(), bucket.end(), adt::array_less<typename Seq::DataType>());
+      auto it = std::unique(bucket.begin(), bucket.end(), adt::array_equal_to<typename Seq::DataType>());
+      bucket.resize(it - bucket.begin());
+      kmers += bucket.size();
     }
+    INFO("K-mer counting done. There are " << kmers << " kmers in total. ");
+    if (!kmers) {
+      FATAL_ERROR("No kmers were extracted from reads. Check the read lengths and k-mer length settings");
+      exit(-1);
+    }
+
+    in_memory_ = true;
+    this->kmers_ = kmers;
+    this->counted_ = true;
+
+    return kmers;
+  }
+
+  void MergeBuckets() override {
+    if (!in_memory_) {
+      __super::MergeBuckets();
+      return;
+    }
+
+    INFO("Merging final buckets.");
+    this->final_kmers_ = this->work_dir_->tmp_file("final_kmers");
+    AsyncBufferedWriter os(this->final_kmers_->file());
+    for (const auto &bucket : buckets_)
+      os.write(bucket.data(), bucket.size() * this->kmer_size());
+
+    // Buckets are consumed by now
+    buckets_.clear();
+    in_memory_ = false;
   }
+
+private:
+  KMerSortingSplitter<Seq> &splitter_;
+  size_t memory_budget_;
+  bool in_memory_;
+  std::vector<adt::KMerVector<Seq>> buckets_;
 };
 
 template<class Index>
@@ -316,12 +412,15 @@ size_t KMerIndexBuilder<Index>::BuildIndex(Index &index, KMerCounter<Seq> &count
 # pragma omp parallel for shared(index) num_threads(num_threads_)
   for (unsigned i = 0; i < buckets; ++i) {
     typename KMerIndex<kmer_index_traits>::KMerDataIndex &data_index = index.index_[i];
-    auto bucket = counter.GetBucket(i, !save_final);
-    size_t sz = bucket->end() - bucket->begin();
+    std::unique_ptr<typename KMerCounter<Seq>::RawKMerStorage> storage;
+    if (!counter.in_memory())
+      storage = counter.GetBucket(i, !save_final);
+    auto bucket = (storage ? adt::make_range(storage->begin(), storage->end()) : counter.GetBucketRange(i));
+    size_t sz = bucket.end() - bucket.begin();
     index.bucket_starts_[i + 1] = sz;
 
     data_index = typename Index::KMerDataIndex(sz,
-                                               boomphf::range(bucket->begin(), bucket->end()),
+                                               boomphf::range(bucket.begin(), bucket.end()),
                                                1, 2.0, false, false);
   }
 
@@ -15,6 +15,11 @@
 
 #include <libcxx/sort.hpp>
 
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace utils {
 
 template<class Seq>
@@ -53,22 +58,77 @@ class KMerSortingSplitter : public KMerSplitter<Seq> {
 public:
     using typename KMerSplitter<Seq>::RawKMers;
 
+    using SeqKMerVector = adt::KMerVector<Seq>;
+
     KMerSortingSplitter(const std::string &work_dir, unsigned K, uint32_t seed = 0)
-            : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0) {}
+            : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0),
+              memory_budget_(0), memory_used_(0), in_memory_(false), nthreads_(0) {}
 
     KMerSortingSplitter(fs::TmpDir work_dir, unsigned K, uint32_t seed = 0)
-            : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0) {}
+            : KMerSplitter<Seq>(work_dir, K, seed), cell_size_(0), num_files_(0),
+              memory_budget_(0), memory_used_(0), in_memory_(false), nthreads_(0) {}
+
+    ~KMerSortingSplitter() {
+        WaitFlush();
+        CloseFiles();
+    }
+
+    // Non-zero budget asks splitter to keep sorted k-mers in memory instead of
+    // dumping them into the raw files. If the budget is exceeded during
+    // splitting, everything is spilled to the raw files and splitter switches
+    // to the ordinary disk mode.
+    void set_memory_budget(size_t budget) { memory_budget_ = budget; }
+
+    // Whether all k-mers of the last Split() are still kept in memory
+    bool in_memory() const { return in_memory_; }
+
+    // In-memory k-mers for every raw file, each one consists of several sorted runs
+    std::vector<SeqKMerVector> &memory_kmers() { return memory_kmers_; }
+
+    void ReleaseMemoryKMers() {
+        memory_kmers_.clear();
+        memory_runs_.clear();
+        memory_used_ = 0;
+        in_memory_ = false;
+    }
 
 protected:
-    using SeqKMerVector = adt::KMerVector<Seq>;
     using KMerBuffer = std::vector<SeqKMerVector>;
 
     std::vector<KMerBuffer> kmer_buffers_;
     size_t cell_size_;
     size_t num_files_;
 
+    size_t memory_budget_;
+    size_t memory_used_;
+    bool in_memory_;
+    std::vector<SeqKMerVector> memory_kmers_;
+    std::vector<std::vector<size_t>> memory_runs_;
+
+    // The second generation of per-thread buffers: while one generation is
+    // being filled, the other one is sorted and written out in background
+    std::vector<KMerBuffer> flush_buffers_;
+    std::thread flusher_;
+    unsigned nthreads_;
+    // Raw k-mer files and their indices, opened on the first write and kept
+    // open until ClearBuffers()
+    std::vector<int> raw_fds_, idx_fds_;
+
     RawKMers PrepareBuffers(size_t num_files, unsigned nthreads, size_t reads_buffer_size) {
+        WaitFlush();
+        CloseFiles();
+
         num_files_ = num_files;
+        nthreads_ = nthreads;
+        raw_fds_.assign(num_files_, -1);
+        idx_fds_.assign(num_files_, -1);
+
+        ReleaseMemoryKMers();
+        if (memory_budget_) {
+            in_memory_ = true;
+            memory_kmers_.resize(num_files_, SeqKMerVector(this->K_));
+            memory_runs_.resize(num_files_);
+        }
 
         // Determine the set of output files
         RawKMers out;
@@ -76,7 +136,7 @@ protected:
         for (unsigned i = 0; i < num_files_; ++i)
             out.emplace_back(tmp_prefix->CreateDep(std::to_string(i)));
 
-        size_t file_limit = num_files_ + 2*nthreads;
+        size_t file_limit = 2*num_files_ + 2*nthreads;
         size_t res = limit_file(file_limit);
         if (res < file_limit) {
             WARN("Failed to setup necessary limit for number of open files. The process might crash later on.");
@@ -89,16 +149,19 @@ protected:
             INFO("Memory available for splitting buffers: " << (double)mem_limit / 1024.0 / 1024.0 / 1024.0 << " Gb");
             reads_buffer_size = std::min(reads_buffer_size, mem_limit);
         }
-        cell_size_ = reads_buffer_size / (num_files_ * this->kmer_size());
+        // Two generations of buffers are alive at the same time
+        cell_size_ = reads_buffer_size / (2 * num_files_ * this->kmer_size());
         // Set sane minimum cell size
         if (cell_size_ < 16384)
             cell_size_ = 16384;
 
         INFO("Using cell size of " << cell_size_);
-        kmer_buffers_.resize(nthreads);
-        for (unsigned i = 0; i < nthreads; ++i) {
-            KMerBuffer &entry = kmer_buffers_[i];
-            entry.resize(num_files_, adt::KMerVector<Seq>(this->K_, (size_t) (1.1 * (double) cell_size_)));
+        for (auto *buffers : { &kmer_buffers_, &flush_buffers_ }) {
+            buffers->resize(nthreads);
+            for (unsigned i = 0; i < nthreads; ++i) {
+                KMerBuffer &entry = (*buffers)[i];
+                entry.resize(num_files_, adt::KMerVector<Seq>(this->K_, (size_t) (1.1 * (double) cell_size_)));
+            }
         }
 
         return out;
@@ -112,61 +175,143 @@ protected:
         return entry[idx].size() > cell_size_;
     }
 
+    static int OpenFile(const std::string &fname) {
+        int fd = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND, (mode_t) 0660);
+        if (fd == -1)
+            FATAL_ERROR("Cannot open temporary file " << fname << " for writing");
+        return fd;
+    }
+
+    static void WriteAll(int fd, const void *buf, size_t amount) {
+        const char *data = (const char *) buf;
+        while (amount) {
+            ssize_t res = ::write(fd, data, amount);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                FATAL_ERROR("I/O error! Incomplete write! Reason: " << strerror(errno) << ". Error code: " << errno);
+            }
+            data += res;
+            amount -= (size_t) res;
+        }
+    }
+
+    // Appends a chunk of k-mers (consisting of several sorted runs) to the k-th raw file
+    void WriteKMers(const RawKMers &ostreams, unsigned k,
+                    const typename Seq::DataType *data, size_t el_data_size, size_t cnt,
+                    const size_t *runs, size_t num_runs) {
+        if (raw_fds_[k] == -1) {
+            raw_fds_[k] = OpenFile(ostreams[k]->file());
+            idx_fds_[k] = OpenFile(ostreams[k]->file() + ".idx");
+        }
+
+        WriteAll(raw_fds_[k], data, el_data_size * cnt);
+        WriteAll(idx_fds_[k], runs, sizeof(size_t) * num_runs);
+    }
+
+    void CloseFiles() {
+        for (auto *fds : { &raw_fds_, &idx_fds_ })
+            for (int &fd : *fds) {
+                if (fd != -1)
+                    ::close(fd);
+                fd = -1;
+            }
+    }
+
+    void WaitFlush() {
+        if (flusher_.joinable())
+            flusher_.join();
+    }
+
+    void SpillMemoryKMers(const RawKMers &ostreams) {
+        INFO("Memory budget for in-memory k-mer counting is exceeded, spilling k-mers to disk");
+#   pragma omp parallel for
+        for (unsigned k = 0; k < num_files_; ++k) {
+            const auto &kmers = memory_kmers_[k];
+            const auto &runs = memory_runs_[k];
+            if (runs.empty())
+                continue;
+            WriteKMers(ostreams, k, kmers.data(), kmers.el_data_size(), kmers.size(),
+                       runs.data(), runs.size());
+        }
+
+        ReleaseMemoryKMers();
+    }
+
+    // Hands the filled buffers to the background flusher and continues with
+    // the second generation. Waits for the previous flush to be completed.
+    // Note that ostreams should outlive the splitting (up to ClearBuffers())
     void DumpBuffers(const RawKMers &ostreams) {
         VERIFY(ostreams.size() == num_files_ && kmer_buffers_[0].size() == num_files_);
 
-#   pragma omp parallel for
+        WaitFlush();
+        std::swap(kmer_buffers_, flush_buffers_);
+        flusher_ = std::thread([this, &ostreams] { FlushBuffers(ostreams); });
+    }
+
+    void FlushBuffers(const RawKMers &ostreams) {
+        if (in_memory_) {
+            size_t sz = 0;
+            for (const auto &entry : flush_buffers_)
+                for (const auto &buffer : entry)
+                    sz += buffer.size();
+            if (memory_used_ + sz * this->kmer_size() > memory_budget_)
+                SpillMemoryKMers(ostreams);
+        }
+
+#   pragma omp parallel for num_threads(nthreads_)
         for (unsigned k = 0; k < num_files_; ++k) {
             // Below k is thread id!
 
             size_t sz = 0;
-            for (size_t i = 0; i < kmer_buffers_.size(); ++i)
-                sz += kmer_buffers_[i][k].size();
+            for (size_t i = 0; i < flush_buffers_.size(); ++i)
+                sz += flush_buffers_[i][k].size();
 
             adt::KMerVector<Seq> SortBuffer(this->K_, sz);
-            for (auto & entry : kmer_buffers_) {
+            for (auto & entry : flush_buffers_) {
                 const auto &buffer = entry[k];
                 for (size_t j = 0; j < buffer.size(); ++j)
                     SortBuffer.push_back(buffer[j]);
             }
             libcxx::sort(SortBuffer.begin(), SortBuffer.end(), typename adt::KMerVector<Seq>::less2_fast());
             auto it = std::unique(SortBuffer.begin(), SortBuffer.end(), typename adt::KMerVector<Seq>::equal_to());
-
-#     pragma omp critical
-            {
-                size_t cnt =  it - SortBuffer.begin();
-
-                // Write k-mers
-                FILE *f = fopen(ostreams[k]->file().c_str(), "ab");
-                if (!f)
-                    FATAL_ERROR("Cannot open temporary file " << ostreams[k]->file() << " for writing");
-                size_t res = fwrite(SortBuffer.data(), SortBuffer.el_data_size(), cnt, f);
-                if (res != cnt)
-                    FATAL_ERROR("I/O error! Incomplete write! Reason: " << strerror(errno) << ". Error code: " << errno);
-                fclose(f);
-
-                // Write index
-                f = fopen((ostreams[k]->file() + ".idx").c_str(), "ab");
-                if (!f)
-                    FATAL_ERROR("Cannot open temporary file " << ostreams[k]->file() << " for writing");
-                res = fwrite(&cnt, sizeof(cnt), 1, f);
-                if (res != 1)
-                    FATAL_ERROR("I/O error! Incomplete write! Reason: " << strerror(errno) << ". Error code: " << errno);
-                fclose(f);
+            size_t cnt =  it - SortBuffer.begin();
+
+            if (in_memory_) {
+                // Every file is touched by a single thread here, no need to lock
+                auto &kmers = memory_kmers_[k];
+                for (auto jt = SortBuffer.begin(); jt != it; ++jt)
+                    kmers.push_back(*jt);
+                memory_runs_[k].push_back(cnt);
+                continue;
             }
+
+            // Every file is written by a single thread, so no locking is needed
+            WriteKMers(ostreams, k, SortBuffer.data(), SortBuffer.el_data_size(), cnt,
+                       &cnt, 1);
+        }
+
+        if (in_memory_) {
+            memory_used_ = 0;
+            for (const auto &kmers : memory_kmers_)
+                memory_used_ += kmers.capacity() * kmers.el_data_size();
         }
 
-        for (auto & entry : kmer_buffers_)
+        for (auto & entry : flush_buffers_)
             for (auto & eentry : entry)
                 eentry.clear();
     }
 
+    // Completes the splitting: waits for the pending flush and closes the raw files
     void ClearBuffers() {
-        for (auto & entry : kmer_buffers_)
-            for (auto & eentry : entry) {
-                eentry.clear();
-                eentry.shrink_to_fit();
-            }
+        WaitFlush();
+        CloseFiles();
+        for (auto *buffers : { &kmer_buffers_, &flush_buffers_ })
+            for (auto & entry : *buffers)
+                for (auto & eentry : entry) {
+                    eentry.clear();
+                    eentry.shrink_to_fit();
+                }
     }
 
     unsigned GetFileNumForSeq(const Seq &s, unsigned total) const {
@@ -93,6 +93,23 @@ size_t get_used_memory() {
 #endif
 }
 
+// Bytes currently allocated by the application (without allocator overhead)
+size_t get_allocated_memory() {
+#ifdef SPADES_USE_JEMALLOC
+    // Statistics are cached by jemalloc and are refreshed on epoch update
+    uint64_t epoch = 1;
+    size_t elen = sizeof(epoch);
+    je_mallctl("epoch", &epoch, &elen, &epoch, elen);
+
+    size_t allocated = 0;
+    size_t alen = sizeof(allocated);
+    je_mallctl("stats.allocated", &allocated, &alen, NULL, 0);
+    return allocated;
+#else
+    return get_used_memory();
+#endif
+}
+
 size_t get_free_memory() {
     return get_memory_limit() - get_used_memory();
 }
@@ -15,6 +15,7 @@ void limit_memory(size_t limit);
 size_t get_memory_limit();
 size_t get_max_rss();
 size_t get_used_memory();
+size_t get_allocated_memory();
 size_t get_free_memory();
 
 }
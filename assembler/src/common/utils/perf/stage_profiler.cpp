@@ -0,0 +1,235 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "stage_profiler.hpp"
+
+#include "utils/verify.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <ftw.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace utils {
+
+static double tv_seconds(const timeval &tv) {
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+}
+
+// Reads "key: value" pairs from /proc/self/io
+static void read_proc_io(ResourceUsage &usage) {
+    std::ifstream is("/proc/self/io");
+    std::string key;
+    size_t value;
+    while (is >> key >> value) {
+        if (key == "rchar:")
+            usage.read_chars = value;
+        else if (key == "wchar:")
+            usage.written_chars = value;
+        else if (key == "read_bytes:")
+            usage.read_bytes = value;
+        else if (key == "write_bytes:")
+            usage.written_bytes = value;
+    }
+}
+
+static size_t read_proc_rss() {
+    std::ifstream is("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    if (!(is >> size >> resident))
+        return 0;
+    return resident * (size_t) sysconf(_SC_PAGESIZE) / 1024;
+}
+
+// User + system CPU time of every thread of the process, from /proc/self/task/*/stat
+static std::map<long, double> thread_times() {
+    std::map<long, double> res;
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir)
+        return res;
+
+    double ticks = (double) sysconf(_SC_CLK_TCK);
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        std::ifstream is(std::string("/proc/self/task/") + entry->d_name + "/stat");
+        std::string stat;
+        if (!std::getline(is, stat))
+            continue;
+
+        // Thread name might contain spaces, the fields after it are numeric
+        size_t pos = stat.rfind(')');
+        if (pos == std::string::npos)
+            continue;
+        std::istringstream fields(stat.substr(pos + 2));
+        std::string skip;
+        // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt
+        for (unsigned i = 0; i < 11; ++i)
+            fields >> skip;
+        size_t utime = 0, stime = 0;
+        if (fields >> utime >> stime)
+            res[std::stol(entry->d_name)] = (double) (utime + stime) / ticks;
+    }
+    closedir(dir);
+
+    return res;
+}
+
+static size_t nftw_total = 0;
+
+static int nftw_add_size(const char *, const struct stat *sb, int type, struct FTW *) {
+    if (type == FTW_F)
+        nftw_total += (size_t) sb->st_size;
+    return 0;
+}
+
+static size_t dir_size(const std::string &dir) {
+    if (dir.empty())
+        return 0;
+
+    nftw_total = 0;
+    nftw(dir.c_str(), nftw_add_size, 16, FTW_PHYS);
+    return nftw_total;
+}
+
+ResourceUsage ResourceUsage::Current() {
+    ResourceUsage usage;
+    usage.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) {
+        usage.user_time = tv_seconds(ru.ru_utime);
+        usage.system_time = tv_seconds(ru.ru_stime);
+        usage.max_rss = (size_t) ru.ru_maxrss;
+    }
+#ifdef RUSAGE_THREAD
+    if (getrusage(RUSAGE_THREAD, &ru) == 0)
+        usage.thread_time = tv_seconds(ru.ru_utime) + tv_seconds(ru.ru_stime);
+#endif
+    usage.rss = read_proc_rss();
+    read_proc_io(usage);
+
+    return usage;
+}
+
+size_t StageProfiler::Start(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Entry entry;
+    entry.name = name;
+    entry.parent = stack_.empty() ? npos : stack_.back();
+    entry.depth = (unsigned) stack_.size();
+    entry.finished = false;
+    entry.threads_start = thread_times();
+    entry.start = ResourceUsage::Current();
+    entry.tmp_bytes = 0;
+
+    stack_.push_back(entries_.size());
+    entries_.push_back(std::move(entry));
+
+    return stack_.back();
+}
+
+void StageProfiler::Finish(size_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    VERIFY_MSG(!stack_.empty() && stack_.back() == id, "Profiled scopes should be properly nested");
+    stack_.pop_back();
+
+    Entry &entry = entries_[id];
+    entry.finish = ResourceUsage::Current();
+    entry.threads_finish = thread_times();
+    entry.tmp_bytes = dir_size(tmp_dir_);
+    entry.finished = true;
+}
+
+static std::string json_string(const std::string &s) {
+    std::string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            res += '\\';
+        if ((unsigned char) c < 0x20)
+            continue;
+        res += c;
+    }
+    return res + "\"";
+}
+
+static std::string entry_path(const std::vector<StageProfiler::Entry> &entries, size_t id) {
+    std::string res = entries[id].name;
+    for (size_t p = entries[id].parent; p != StageProfiler::npos; p = entries[p].parent)
+        res = entries[p].name + "/" + res;
+    return res;
+}
+
+void StageProfiler::WriteJSON(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ResourceUsage now = ResourceUsage::Current();
+    std::map<long, double> threads_now = thread_times();
+
+    os << "{\n  \"stages\": [";
+    for (size_t id = 0; id < entries_.size(); ++id) {
+        const Entry &entry = entries_[id];
+        // Report the scopes still running as of now
+        const ResourceUsage &start = entry.start, &finish = entry.finished ? entry.finish : now;
+        const auto &threads_finish = entry.finished ? entry.threads_finish : threads_now;
+
+        std::vector<double> threads;
+        for (const auto &kv : threads_finish) {
+            auto it = entry.threads_start.find(kv.first);
+            double time = kv.second - (it == entry.threads_start.end() ? 0 : it->second);
+            if (time > 0)
+                threads.push_back(time);
+        }
+
+        os << (id ? ",\n" : "\n") << "    {"
+           << "\"name\": " << json_string(entry.name)
+           << ", \"path\": " << json_string(entry_path(entries_, id))
+           << ", \"depth\": " << entry.depth
+           << ", \"finished\": " << (entry.finished ? "true" : "false")
+           << ", \"wall_time\": " << finish.wall_time - start.wall_time
+           << ", \"user_time\": " << finish.user_time - start.user_time
+           << ", \"system_time\": " << finish.system_time - start.system_time
+           << ", \"main_thread_time\": " << finish.thread_time - start.thread_time
+           << ", \"thread_times\": [";
+        for (size_t i = 0; i < threads.size(); ++i)
+            os << (i ? ", " : "") << threads[i];
+        os << "]"
+           << ", \"max_rss_kb\": " << finish.max_rss
+           << ", \"max_rss_delta_kb\": " << finish.max_rss - start.max_rss
+           << ", \"rss_start_kb\": " << start.rss
+           << ", \"rss_finish_kb\": " << finish.rss
+           << ", \"read_chars\": " << finish.read_chars - start.read_chars
+           << ", \"written_chars\": " << finish.written_chars - start.written_chars
+           << ", \"read_bytes\": " << finish.read_bytes - start.read_bytes
+           << ", \"written_bytes\": " << finish.written_bytes - start.written_bytes
+           << ", \"tmp_bytes\": " << entry.tmp_bytes
+           << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void StageProfiler::Flush() const {
+    if (output_file_.empty())
+        return;
+
+    std::ofstream os(output_file_);
+    WriteJSON(os);
+}
+
+StageProfiler &stage_profiler() {
+    static StageProfiler profiler;
+    return profiler;
+}
+
+}
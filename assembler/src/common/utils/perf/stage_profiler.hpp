@@ -0,0 +1,98 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <iosfwd>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+/**
+ * @brief Snapshot of the resources consumed by the process so far.
+ *        Fields which could not be obtained on the current platform are zero.
+ */
+struct ResourceUsage {
+    double wall_time = 0;     // seconds, monotonic clock
+    double user_time = 0;     // seconds, all threads of the process
+    double system_time = 0;   // seconds, all threads of the process
+    double thread_time = 0;   // seconds, user + system of the calling thread
+    size_t max_rss = 0;       // KB, peak resident set size
+    size_t rss = 0;           // KB, current resident set size
+    size_t read_chars = 0;    // bytes passed to read(2)-like calls
+    size_t written_chars = 0; // bytes passed to write(2)-like calls
+    size_t read_bytes = 0;    // bytes actually fetched from the storage
+    size_t written_bytes = 0; // bytes actually sent to the storage
+
+    static ResourceUsage Current();
+};
+
+/**
+ * @brief Records resource usage of the pipeline stages and their nested substages
+ *        (phases, simplification cycles, etc) and dumps it as JSON report.
+ *        Scopes are expected to be opened and closed from the main thread only,
+ *        CPU time of every thread (e.g. OpenMP workers) is accounted separately.
+ */
+class StageProfiler {
+public:
+    struct Entry {
+        std::string name;
+        size_t parent;
+        unsigned depth;
+        bool finished;
+        ResourceUsage start, finish;
+        std::map<long, double> threads_start, threads_finish;
+        size_t tmp_bytes;
+    };
+
+    static const size_t npos = size_t(-1);
+
+    void set_output_file(const std::string &filename) { output_file_ = filename; }
+    void set_tmp_dir(const std::string &dir) { tmp_dir_ = dir; }
+
+    // Opens new scope nested into the current one, returns its id
+    size_t Start(const std::string &name);
+    void Finish(size_t id);
+
+    const std::vector<Entry> &entries() const { return entries_; }
+
+    void WriteJSON(std::ostream &os) const;
+    // Rewrites the output file (if any) with the current state of the report
+    void Flush() const;
+
+private:
+    std::vector<Entry> entries_;
+    std::vector<size_t> stack_;
+    std::string output_file_;
+    std::string tmp_dir_;
+    mutable std::mutex mutex_;
+};
+
+StageProfiler &stage_profiler();
+
+/**
+ * @brief RAII helper which profiles the enclosing scope.
+ */
+class ProfiledScope {
+public:
+    ProfiledScope(const std::string &name)
+            : id_(stage_profiler().Start(name)) {}
+
+    ~ProfiledScope() {
+        stage_profiler().Finish(id_);
+    }
+
+private:
+    ProfiledScope(const ProfiledScope &) = delete;
+    ProfiledScope &operator=(const ProfiledScope &) = delete;
+
+    size_t id_;
+};
+
+}
@@ -14,6 +14,7 @@
 #include "paired_info/weighted_distance_estimation.hpp"
 #include "paired_info/smoothing_distance_estimation.hpp"
 #include "paired_info/weights.hpp"
+#include "assembly_graph/paths/distance_oracle.hpp"
 
 #include "distance_estimation.hpp"
 #include <set>
@@ -99,7 +100,8 @@ void RefinePairedInfo(const Graph& graph, PairedInfoIndexT<Graph>& clustered_ind
 void estimate_scaffolding_distance(conj_graph_pack& gp,
                        const io::SequencingLibrary<config::LibraryData> &lib,
                        const UnclusteredPairedIndexT& paired_index,
-                       PairedIndexT& scaffolding_index) {
+                       PairedIndexT& scaffolding_index,
+                       const omnigraph::GraphDistanceOracle<Graph> *oracle) {
     INFO("Filling scaffolding index");
 
     double is_var = lib.data().insert_size_deviation;
@@ -107,6 +109,7 @@ void estimate_scaffolding_distance(conj_graph_pack& gp,
     size_t linkage_distance = size_t(cfg::get().de.linkage_distance_coeff * is_var);
     GraphDistanceFinder dist_finder(gp.g, (size_t) math::round(lib.data().mean_insert_size),
                                     lib.data().unmerged_read_length, delta);
+    dist_finder.SetOracle(oracle);
     size_t max_distance = size_t(cfg::get().de.max_distance_coeff_scaff * is_var);
 
     DEBUG("Retaining insert size distribution for it");
@@ -136,12 +139,14 @@ void estimate_scaffolding_distance(conj_graph_pack& gp,
 void estimate_distance(conj_graph_pack& gp,
                        const io::SequencingLibrary<config::LibraryData> &lib,
                        const UnclusteredPairedIndexT& paired_index,
-                       PairedIndexT& clustered_index) {
+                       PairedIndexT& clustered_index,
+                       const omnigraph::GraphDistanceOracle<Graph> *oracle) {
 
     const config::debruijn_config& config = cfg::get();
     size_t delta = size_t(lib.data().insert_size_deviation);
     size_t linkage_distance = size_t(config.de.linkage_distance_coeff * lib.data().insert_size_deviation);
     GraphDistanceFinder dist_finder(gp.g,  (size_t)math::round(lib.data().mean_insert_size), lib.data().unmerged_read_length, delta);
+    dist_finder.SetOracle(oracle);
     size_t max_distance = size_t(config.de.max_distance_coeff * lib.data().insert_size_deviation);
 
     PairInfoWeightChecker<Graph> checker(gp.g, config.de.clustered_filter_threshold);
@@ -166,16 +171,37 @@ void estimate_distance(conj_graph_pack& gp,
 
 }
 
+// Both estimators query the same vertex pairs with the same path length bound,
+// so the graph distances are computed once for the library
+static void BuildDistanceOracle(const conj_graph_pack& gp,
+                                const UnclusteredPairedIndexT& paired_index,
+                                omnigraph::GraphDistanceOracle<Graph> &oracle) {
+    INFO("Precomputing graph distances");
+    std::vector<std::pair<VertexId, VertexId>> queries;
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+        EdgeId e1 = *it;
+        for (auto entry : paired_index.GetHalf(e1))
+            queries.emplace_back(gp.g.EdgeEnd(e1), gp.g.EdgeStart(entry.first));
+    }
+    oracle.Build(std::move(queries), cfg::get().max_threads);
+}
+
 void DistanceEstimation::run(conj_graph_pack &gp, const char*) {
     for (size_t i = 0; i < cfg::get().ds.reads.lib_count(); ++i)
         if (cfg::get().ds.reads[i].type() == io::LibraryType::PairedEnd) {
             if (cfg::get().ds.reads[i].data().mean_insert_size != 0.0) {
                 INFO("Processing library #" << i);
-                estimate_distance(gp, cfg::get().ds.reads[i], gp.paired_indices[i],
-                                  gp.clustered_indices[i]);
+                const auto &lib = cfg::get().ds.reads[i];
+                GraphDistanceFinder dist_finder(gp.g, (size_t) math::round(lib.data().mean_insert_size),
+                                                lib.data().unmerged_read_length,
+                                                size_t(lib.data().insert_size_deviation));
+                omnigraph::GraphDistanceOracle<Graph> oracle(gp.g, dist_finder.path_upper_bound());
+                BuildDistanceOracle(gp, gp.paired_indices[i], oracle);
+                estimate_distance(gp, lib, gp.paired_indices[i],
+                                  gp.clustered_indices[i], &oracle);
                 if (cfg::get().pe_params.param_set.scaffolder_options.cluster_info) {
-                    estimate_scaffolding_distance(gp, cfg::get().ds.reads[i], gp.paired_indices[i],
-                                                  gp.scaffolding_indices[i]);
+                    estimate_scaffolding_distance(gp, lib, gp.paired_indices[i],
+                                                  gp.scaffolding_indices[i], &oracle);
                 }
             }
             if (!cfg::get().preserve_raw_paired_index) {
@@ -24,6 +24,7 @@
 #include "chromosome_removal.hpp"
 #include "series_analysis.hpp"
 #include "pipeline/stage.hpp"
+#include "utils/perf/stage_profiler.hpp"
 #include "contig_output_stage.hpp"
 
 namespace spades {
@@ -78,6 +79,12 @@ void assemble_genome() {
         conj_gp.kmer_mapper.Attach();
     }
 
+    if (cfg::get().mapping_cache) {
+        conj_gp.mapping_cache_dir = fs::append_path(cfg::get().output_dir, "mapping_cache");
+        fs::make_dirs(conj_gp.mapping_cache_dir);
+        INFO("Read mappings will be cached in " << conj_gp.mapping_cache_dir);
+    }
+
     // Build the pipeline
     SPAdes.add<debruijn_graph::Construction>();
 
@@ -143,6 +150,11 @@ void assemble_genome() {
 
     SPAdes.add<debruijn_graph::ContigOutput>(cfg::get().main_iteration);
 
+    // Per-stage resource usage report, stored next to spades.log
+    utils::stage_profiler().set_output_file(fs::append_path(cfg::get().output_base,
+                                                            "stage_profile_K" + std::to_string(cfg::get().K) + ".json"));
+    utils::stage_profiler().set_tmp_dir(cfg::get().tmp_dir);
+
     SPAdes.run(conj_gp, cfg::get().entry_point.c_str());
 
     // For informing spades.py about estimated params
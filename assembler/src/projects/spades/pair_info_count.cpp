@@ -109,6 +109,12 @@ class EdgePairCounterFiller : public SequenceMapperListener {
     std::pair<double, bool> cardinality() const {
         return counter_.cardinality();
     }
+
+    // The number of edge pairs is extrapolated if only a part of the library
+    // was processed, so the counter does not prevent the early stop
+    bool Saturated() const override {
+        return true;
+    }
   private:
     void ProcessPairedRead(EdgePairCounter &buf,
                            const MappingPath<EdgeId>& path1,
@@ -189,6 +195,8 @@ static bool CollectLibInformation(const conj_graph_pack &gp,
                                   size_t ilib, size_t edge_length_threshold) {
     INFO("Estimating insert size (takes a while)");
     InsertSizeCounter hist_counter(gp, edge_length_threshold);
+    if (cfg::get().de.is_early_stop_pairs)
+        hist_counter.EnableEarlyStop(cfg::get().de.is_early_stop_pairs, cfg::get().de.is_confidence);
     EdgePairCounterFiller pcounter(cfg::get().max_threads);
 
     SequenceMapperNotifier notifier(gp, cfg::get_writable().ds.reads.lib_count());
@@ -200,12 +208,19 @@ static bool CollectLibInformation(const conj_graph_pack &gp,
     auto paired_streams = paired_binary_readers(reads, /*followed by rc*/false, /*insert_size*/0,
                                                 /*include_merged*/true);
 
-    notifier.ProcessLibrary(paired_streams, ilib, *ChooseProperMapper(gp, reads));
+    bool stopped_early = notifier.ProcessLibrary(paired_streams, ilib, *ChooseProperMapper(gp, reads));
     //Check read length after lib processing since mate pairs a not used until this step
     VERIFY(reads.data().unmerged_read_length != 0);
 
     auto pres = pcounter.cardinality();
     edgepairs = (!pres.second ? 64ull * 1024 * 1024 : size_t(pres.first));
+    if (pres.second && stopped_early) {
+        // Only a part of the library was processed. Distinct edge pairs grow sublinearly
+        // with the number of reads, so the extrapolation overestimates them (up to the rough limit)
+        double processed = (double) std::max(hist_counter.total(), size_t(1));
+        double scale = std::max(1., (double) data.read_count / 2 / processed);
+        edgepairs = std::max(edgepairs, std::min(size_t((double) edgepairs * scale), size_t(64ull * 1024 * 1024)));
+    }
     INFO("Edge pairs: " << edgepairs << (!pres.second ? " (rough upper limit)" : ""));
 
     INFO(hist_counter.mapped() << " paired reads (" <<
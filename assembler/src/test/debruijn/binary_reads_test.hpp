@@ -0,0 +1,142 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+
+#include "test_utils.hpp"
+#include "io/reads/binary_converter.hpp"
+#include "io/reads/binary_streams.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(binary_reads_tests, fs::TmpFolderFixture)
+
+static std::vector<std::vector<std::string>> RandomReadSets(size_t sets, size_t reads, size_t length) {
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> digit(0, 3);
+    std::vector<std::vector<std::string>> answer(sets);
+    for (auto &set : answer) {
+        for (size_t i = 0; i < reads; ++i) {
+            std::string read;
+            for (size_t j = 0; j < length; ++j)
+                read += nucl((char) digit(rnd));
+            set.push_back(read);
+        }
+    }
+    return answer;
+}
+
+BOOST_AUTO_TEST_CASE( BinaryWriterShardAssignment ) {
+    typedef io::VectorReadStream<io::SingleRead> RawStream;
+    const size_t shards = 2;
+    auto read_sets = RandomReadSets(3, 7, 50);
+
+    io::ReadStreamList<io::SingleRead> streams;
+    for (const auto &set : read_sets)
+        streams.push_back(make_shared<RawStream>(MakeReads(set)));
+
+    auto workdir = fs::tmp::make_temp_dir("tmp", "tests");
+    std::string prefix = fs::append_path(workdir->dir(), "reads");
+    {
+        // The smallest buffer makes every read a separate chunk
+        io::BinaryWriter writer(prefix, shards, 1);
+        io::ReadStreamStat stat = writer.ToBinary(streams);
+        BOOST_CHECK_EQUAL(3u * 7u, stat.read_count);
+    }
+
+    // Chunk c of stream s goes to shard (s + c) % shards, streams are kept in order
+    for (size_t shard = 0; shard < shards; ++shard) {
+        io::BinaryFileSingleStream stream(prefix, shard);
+        for (size_t s = 0; s < read_sets.size(); ++s) {
+            for (size_t c = 0; c < read_sets[s].size(); ++c) {
+                if ((s + c) % shards != shard)
+                    continue;
+                BOOST_REQUIRE(!stream.eof());
+                io::SingleReadSeq read;
+                stream >> read;
+                BOOST_CHECK_EQUAL(Sequence(read_sets[s][c]), read.sequence());
+            }
+        }
+        BOOST_CHECK(stream.eof());
+    }
+}
+
+//Batched decoding (direct and through the read dispatcher) gives the same reads as operator>>
+BOOST_AUTO_TEST_CASE( BinaryStreamReadBatch ) {
+    typedef io::VectorReadStream<io::SingleRead> RawStream;
+    const size_t shards = 2;
+    auto read_sets = RandomReadSets(3, 1000, 50);
+
+    io::ReadStreamList<io::SingleRead> streams;
+    for (const auto &set : read_sets)
+        streams.push_back(make_shared<RawStream>(MakeReads(set)));
+
+    auto workdir = fs::tmp::make_temp_dir("tmp", "tests");
+    std::string prefix = fs::append_path(workdir->dir(), "reads");
+    {
+        io::BinaryWriter writer(prefix, shards, 1000);
+        writer.ToBinary(streams);
+    }
+
+    io::ReadStreamList<io::SingleReadSeq> binary_streams;
+    for (size_t shard = 0; shard < shards; ++shard) {
+        std::vector<io::SingleReadSeq> etalon;
+        io::BinaryFileSingleStream stream(prefix, shard);
+        while (!stream.eof()) {
+            etalon.emplace_back();
+            stream >> etalon.back();
+        }
+
+        for (size_t batch_size : {1, 7, 1000, 10000}) {
+            stream.reset();
+            std::vector<io::SingleReadSeq> reads, batch;
+            while (stream.ReadBatch(batch, batch_size) > 0) {
+                BOOST_CHECK(batch.size() <= batch_size);
+                reads.insert(reads.end(), batch.begin(), batch.end());
+            }
+            BOOST_CHECK(stream.eof());
+            BOOST_CHECK(reads == etalon);
+        }
+
+        // Mixed with operator>>
+        stream.reset();
+        std::vector<io::SingleReadSeq> reads(1), batch;
+        stream >> reads.back();
+        stream.ReadBatch(batch, 10);
+        reads.insert(reads.end(), batch.begin(), batch.end());
+        reads.emplace_back();
+        stream >> reads.back();
+        BOOST_CHECK(std::equal(reads.begin(), reads.end(), etalon.begin()));
+
+        binary_streams.push_back(make_shared<io::BinaryFileSingleStream>(prefix, shard));
+    }
+
+    size_t total = 0, stream_idx, start;
+    std::vector<io::SingleReadSeq> batch;
+    ReadBatchDispatcher<io::SingleReadSeq> dispatcher(binary_streams);
+    while (dispatcher.Next(0, 100, batch, stream_idx, start)) {
+        io::BinaryFileSingleStream etalon(prefix, stream_idx);
+        for (size_t i = 0; i < start; ++i) {
+            io::SingleReadSeq read;
+            etalon >> read;
+        }
+        for (const auto &read : batch) {
+            io::SingleReadSeq expected;
+            etalon >> expected;
+            BOOST_CHECK(read == expected);
+        }
+        total += batch.size();
+    }
+    BOOST_CHECK_EQUAL(read_sets.size() * read_sets[0].size(), total);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -10,6 +10,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include "test_utils.hpp"
+#include "assembly_graph/dijkstra/dijkstra_helper.hpp"
+#include "assembly_graph/paths/distance_oracle.hpp"
+#include "paired_info/is_counter.hpp"
+
+#include <random>
 
 namespace debruijn_graph {
 
@@ -215,6 +220,208 @@ BOOST_AUTO_TEST_CASE( SimpleTestEarlyPairedInfo ) {
     AssertGraph(3, paired_reads, 5, 6, edges, coverage_info, edge_pair_info);
 }
 
+BOOST_AUTO_TEST_CASE( TestMappingCacheReplay ) {
+    typedef io::VectorReadStream<io::PairedRead> RawStream;
+    vector<MyPairedRead> paired_reads = {{"CCCAC", "CCACG"}, {"ACCAC", "CCACA"}};
+    EdgePairInfo edge_pair_info = {{{"CCCA", "CACG"}, {2, 1.0}}, {{"ACCA", "CACA"}, {2, 1.0}}
+        , {{"CCCA", "CCAC"}, {1, 1.0}}, {{"ACCA", "CCAC"}, {1, 1.0}}
+        , {{"CCAC", "CACG"}, {1, 1.0}}, {{"CCAC", "CACA"}, {1, 1.0}}};
+
+    io::ReadStreamList<io::PairedRead> paired_streams(make_shared<RawStream>(MakePairedReads(paired_reads, 6)));
+    conj_graph_pack gp(3, "tmp", 2);
+    auto workdir = fs::tmp::make_temp_dir(gp.workdir, "tests");
+    io::ReadStreamList<io::SingleRead> single_stream_vector = io::SquashingWrap<io::PairedRead>(paired_streams);
+    ConstructGraphWithCoverage(config::debruijn_config::construction(), workdir,
+                               single_stream_vector, gp.g, gp.index, gp.flanking_cov);
+    gp.kmer_mapper.Attach();
+    gp.EnsureBasicMapping();
+    gp.mapping_cache_dir = workdir->dir();
+    // The hash maintained during the construction matches the one computed from scratch
+    BOOST_CHECK_EQUAL(gp.content_hash.hash(), omnigraph::GraphContentHash<Graph>(gp.g).hash());
+
+    // The first pass writes the cache, the second one replays it
+    for (size_t i = 0; i < 2; ++i) {
+        SequenceMapperNotifier notifier(gp, 1);
+        LatePairedIndexFiller pif(gp.g, PairedReadCountWeight, 0, gp.paired_indices[i]);
+        notifier.Subscribe(0, &pif);
+        notifier.ProcessLibrary(paired_streams, 0, *MapperInstance(gp));
+        BOOST_CHECK_EQUAL(notifier.replayed_reads(), i == 0 ? 0 : paired_reads.size());
+        AssertPairInfo(gp.g, gp.paired_indices[i], AddComplement(AddBackward(edge_pair_info)));
+    }
+}
+
+class SaturatedListener : public SequenceMapperListener {
+public:
+    bool Saturated() const override { return true; }
+};
+
+BOOST_AUTO_TEST_CASE( TestInsertSizeEarlyStop ) {
+    typedef io::VectorReadStream<io::SingleRead> SingleStream;
+    typedef io::VectorReadStream<io::PairedRead> PairedStream;
+    const size_t k = 21, read_length = 100, insert_size = 300, genome_length = 20000, pair_count = 20000;
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> digit(0, 3);
+    std::uniform_int_distribution<size_t> pos(0, genome_length - insert_size);
+
+    std::string genome;
+    for (size_t i = 0; i < genome_length; ++i)
+        genome += nucl((char) digit(rnd));
+    std::vector<io::SingleRead> genome_reads;
+    for (size_t i = 0; i + read_length <= genome_length; i += read_length / 2)
+        genome_reads.emplace_back(std::to_string(i), genome.substr(i, read_length));
+
+    std::vector<io::PairedRead> pairs;
+    for (size_t i = 0; i < pair_count; ++i) {
+        size_t p = pos(rnd);
+        pairs.emplace_back(MakeRead(genome.substr(p, read_length)),
+                           MakeRead(genome.substr(p + insert_size - read_length, read_length)), insert_size);
+    }
+
+    conj_graph_pack gp(k, "tmp", 0);
+    auto workdir = fs::tmp::make_temp_dir(gp.workdir, "tests");
+    io::ReadStreamList<io::SingleRead> streams(io::RCWrap<io::SingleRead>(make_shared<SingleStream>(genome_reads)));
+    ConstructGraph(config::debruijn_config::construction(), workdir, streams, gp.g, gp.index);
+    gp.kmer_mapper.Attach();
+    gp.EnsureBasicMapping();
+    io::ReadStreamList<io::PairedRead> paired_streams(make_shared<PairedStream>(pairs));
+
+    // Every listener agrees, the library is skipped after the first merged buffers
+    {
+        SequenceMapperNotifier notifier(gp, 1, 1000);
+        InsertSizeCounter hist_counter(gp, 0);
+        hist_counter.EnableEarlyStop(1000, 0.95);
+        SaturatedListener listener;
+        notifier.Subscribe(0, &hist_counter);
+        notifier.Subscribe(0, &listener);
+        BOOST_CHECK(notifier.ProcessLibrary(paired_streams, 0, *MapperInstance(gp), 1));
+        BOOST_CHECK(hist_counter.total() < pair_count);
+        BOOST_CHECK(hist_counter.mapped() >= 1000);
+        double median, mad;
+        std::map<int, size_t> hist;
+        hist_counter.FindMedian(median, mad, hist);
+        BOOST_CHECK_EQUAL(double(insert_size), median);
+    }
+
+    // A listener that does not vote keeps the whole library processed
+    {
+        SequenceMapperNotifier notifier(gp, 1, 1000);
+        InsertSizeCounter hist_counter(gp, 0);
+        hist_counter.EnableEarlyStop(1000, 0.95);
+        SequenceMapperListener listener;
+        notifier.Subscribe(0, &hist_counter);
+        notifier.Subscribe(0, &listener);
+        BOOST_CHECK(!notifier.ProcessLibrary(paired_streams, 0, *MapperInstance(gp), 1));
+        BOOST_CHECK_EQUAL(pair_count, hist_counter.total());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestKMerMap ) {
+    const unsigned k = 56;
+    std::mt19937 rnd(42);
+    auto random_kmer = [&]() {
+        // Small alphabet to get repeated keys
+        std::string s;
+        for (unsigned i = 0; i < k; ++i)
+            s += (i < 48 ? 'A' : nucl((char) (rnd() % 4)));
+        return RtSeq(k, s.c_str());
+    };
+
+    KMerMap map(k);
+    std::map<RtSeq, RtSeq, RtSeq::less3> etalon;
+    for (size_t i = 0; i < 100000; ++i) {
+        RtSeq key = random_kmer();
+        switch (rnd() % 3) {
+            case 0: {
+                RtSeq value = random_kmer();
+                map.set(key, value);
+                etalon.erase(key);
+                etalon.emplace(key, value);
+                break;
+            }
+            case 1:
+                map.erase(key);
+                etalon.erase(key);
+                break;
+            default: {
+                auto it = etalon.find(key);
+                const auto *value = map.find(key);
+                BOOST_CHECK_EQUAL(value != nullptr, it != etalon.end());
+                if (value && it != etalon.end())
+                    BOOST_CHECK_EQUAL(RtSeq(k, value), it->second);
+            }
+        }
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), etalon.size());
+    size_t count = 0;
+    for (auto it = map.begin(); it != map.end(); ++it, ++count)
+        BOOST_CHECK(etalon.count(it->first) && etalon.find(it->first)->second == it->second);
+    BOOST_CHECK_EQUAL(count, etalon.size());
+
+    //Per-entry memory: 40 byte slots at the load factor in (3/8, 3/4]
+    KMerMap large(k);
+    for (size_t i = 0; i < 1000000; ++i) {
+        std::string s;
+        for (unsigned j = 0; j < k; ++j)
+            s += nucl((char) (rnd() % 4));
+        large.set(RtSeq(k, s.c_str()), RtSeq(k, s.c_str()));
+    }
+    double per_entry = double(large.memory_usage()) / double(large.size());
+    INFO("KMerMap with " << large.size() << " entries takes " << per_entry << " bytes per entry");
+    BOOST_CHECK(per_entry >= 40. * 4 / 3 && per_entry <= 40. * 8 / 3 + 1);
+}
+
+//Edge index updated at the end of the batch scope should match the graph
+BOOST_AUTO_TEST_CASE( TestBatchedIndexUpdate ) {
+    typedef io::VectorReadStream<io::SingleRead> RawStream;
+    const size_t k = 21, read_length = 100, genome_length = 5000;
+    std::mt19937 rnd(42);
+    std::string genome;
+    for (size_t i = 0; i < genome_length; ++i)
+        genome += nucl((char) (rnd() % 4));
+    //a couple of repeats to get several edges
+    genome += genome.substr(1000, 300) + genome.substr(3000, 2000) + genome.substr(1000, 300);
+    std::vector<io::SingleRead> reads;
+    for (size_t i = 0; i + read_length <= genome.size(); i += read_length / 2)
+        reads.emplace_back(std::to_string(i), genome.substr(i, read_length));
+
+    conj_graph_pack gp(k, "tmp", 0);
+    auto workdir = fs::tmp::make_temp_dir(gp.workdir, "tests");
+    io::ReadStreamList<io::SingleRead> streams(io::RCWrap<io::SingleRead>(make_shared<RawStream>(reads)));
+    ConstructGraph(config::debruijn_config::construction(), workdir, streams, gp.g, gp.index);
+    gp.EnsureIndex();
+
+    std::vector<EdgeId> edges;
+    for (auto it = gp.g.ConstEdgeBegin(/*canonical only*/true); !it.IsEnd(); ++it)
+        edges.push_back(*it);
+    BOOST_CHECK(edges.size() > 1);
+
+    {
+        Graph::BatchScope batch(gp.g);
+        for (EdgeId e : edges) {
+            if (gp.g.length(e) < 100 || e == gp.g.conjugate(e))
+                continue;
+            //edges added and deleted inside the batch, then edges only added
+            auto parts = gp.g.SplitEdge(e, 40);
+            gp.g.SplitEdge(parts.second, 30);
+            gp.g.CompressVertex(gp.g.EdgeEnd(parts.first));
+        }
+    }
+
+    //edge index is built over (k+1)-mers
+    const size_t kplusone = gp.index.k();
+    for (auto it = gp.g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+        EdgeId e = *it;
+        const Sequence &nucls = gp.g.EdgeNucls(e);
+        for (size_t i = 0; i + kplusone <= nucls.size(); ++i) {
+            RtSeq kmer = nucls.Subseq(i, i + kplusone).start<RtSeq>(kplusone);
+            BOOST_CHECK(gp.index.contains(kmer));
+            EdgeId found = gp.index.get(kmer).first;
+            BOOST_CHECK(found == e || found == gp.g.conjugate(e));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE( TestSelfRCEdgeMerge ) {
     Graph g(5);
     VertexId v1 = g.AddVertex();
@@ -228,6 +435,68 @@ BOOST_AUTO_TEST_CASE( TestSelfRCEdgeMerge ) {
     BOOST_CHECK_EQUAL(Sequence("AACGCTATTCACGTGAATAGCGTT"), g.EdgeNucls(g.GetUniqueOutgoingEdge(v1)));
 }
 
+//Bounded Dijkstra runs (sharing the pooled workspace) should match the naive relaxation
+BOOST_AUTO_TEST_CASE( TestBoundedDijkstra ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    const size_t bound = 1000;
+
+    for (VertexId start : g) {
+        std::map<VertexId, size_t> expected = {{start, 0}};
+        for (bool changed = true; changed; ) {
+            changed = false;
+            for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+                EdgeId e = *it;
+                if (!expected.count(g.EdgeStart(e)))
+                    continue;
+                size_t dist = expected[g.EdgeStart(e)] + g.length(e);
+                if (dist <= bound && (!expected.count(g.EdgeEnd(e)) || expected[g.EdgeEnd(e)] > dist)) {
+                    expected[g.EdgeEnd(e)] = dist;
+                    changed = true;
+                }
+            }
+        }
+
+        auto dijkstra = omnigraph::DijkstraHelper<Graph>::CreateBoundedDijkstra(g, bound);
+        dijkstra.Run(start);
+        auto reached = dijkstra.ReachedVertices();
+        BOOST_CHECK_EQUAL(reached.size(), expected.size());
+        BOOST_CHECK(std::is_sorted(reached.begin(), reached.end()));
+        for (const auto &entry : expected) {
+            BOOST_CHECK(dijkstra.DistanceCounted(entry.first));
+            BOOST_CHECK_EQUAL(dijkstra.GetDistance(entry.first), entry.second);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestGraphDistanceOracle ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    const size_t bound = 1000;
+
+    std::vector<std::pair<VertexId, VertexId>> queries;
+    for (VertexId v1 : g)
+        for (VertexId v2 : g)
+            queries.emplace_back(v1, v2);
+
+    omnigraph::GraphDistanceOracle<Graph> oracle(g, bound);
+    oracle.Build(queries, 1);
+    for (const auto &query : queries) {
+        omnigraph::DistancesLengthsCallback<Graph> callback(g);
+        omnigraph::ProcessPaths(g, 0, bound, query.first, query.second, callback);
+        std::vector<size_t> lengths;
+        BOOST_CHECK(oracle.GetLengths(query.first, query.second, bound, lengths));
+        BOOST_CHECK(lengths == callback.distances());
+    }
+
+    std::vector<size_t> lengths;
+    BOOST_CHECK(!oracle.GetLengths(*g.begin(), *g.begin(), bound + 1, lengths));
+
+    g.DeleteEdge(*g.ConstEdgeBegin());
+    BOOST_CHECK(!oracle.valid());
+    BOOST_CHECK(!oracle.GetLengths(*g.begin(), *g.begin(), bound, lengths));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
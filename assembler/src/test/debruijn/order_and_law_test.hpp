@@ -142,5 +142,24 @@ BOOST_AUTO_TEST_CASE( OrderTest ) {
 //    BOOST_CHECK(checker.CheckOrder(graph.SmartVertexBegin(), new_graph.SmartVertexBegin()));
 //    BOOST_CHECK(checker.CheckOrder(graph.SmartEdgeBegin(), new_graph.SmartEdgeBegin()));
 }
+
+BOOST_AUTO_TEST_CASE( BinaryOrderTest ) {
+    auto workdir = fs::tmp::make_temp_dir("tmp", "tests");
+    string file_name = fs::append_path(workdir->dir(), "test_binary_save");
+    Graph graph(55);
+    RandomGraphConstructor<Graph>(1000, 100, 100).Generate(graph);
+    graphio::ConjugateDataPrinter<Graph> printer(graph);
+    printer.SaveBinaryGraph(file_name);
+    Graph new_graph(55);
+    graphio::ConjugateDataScanner<Graph> scanner(new_graph);
+    BOOST_CHECK(scanner.LoadBinaryGraph(file_name));
+    IteratorOrderChecker<Graph> checker(graph, new_graph);
+    BOOST_CHECK(checker.CheckOrder(graph.SmartVertexBegin(), new_graph.SmartVertexBegin()));
+    BOOST_CHECK(checker.CheckOrder(graph.SmartEdgeBegin(), new_graph.SmartEdgeBegin()));
+    for (auto it1 = graph.SmartEdgeBegin(), it2 = new_graph.SmartEdgeBegin(); !it1.IsEnd() && !it2.IsEnd(); ++it1, ++it2) {
+        BOOST_CHECK_EQUAL(graph.EdgeNucls(*it1), new_graph.EdgeNucls(*it2));
+        BOOST_CHECK_EQUAL(graph.coverage(*it1), new_graph.coverage(*it2));
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
 }
@@ -0,0 +1,98 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "paired_info/paired_info.hpp"
+#include "paired_info/compressed_paired_info.hpp"
+#include "utils/memory_limit.hpp"
+
+#include <chrono>
+#include <random>
+
+namespace debruijn_graph {
+
+using namespace omnigraph::de;
+
+BOOST_AUTO_TEST_SUITE(paired_info_benchmarks)
+
+class MockLargeGraph {
+public:
+    typedef size_t EdgeId;
+
+    MockLargeGraph(size_t edges)
+            : edges_(edges) {}
+
+    size_t size() const { return edges_; }
+    EdgeId conjugate(EdgeId id) const { return id ^ 1; }
+    size_t length(EdgeId id) const { return 100 + (id >> 1) % 1000; }
+    size_t int_id(EdgeId id) const { return id; }
+
+private:
+    size_t edges_;
+};
+
+template<class Index>
+double LookupWeight(const Index &index, const std::vector<std::pair<size_t, size_t>> &queries) {
+    double weight = 0;
+    for (const auto &q : queries) {
+        for (auto point : index.Get(q.first, q.second))
+            weight += point.weight;
+    }
+    return weight;
+}
+
+//Memory / latency comparison of btree-based and compressed indices
+BOOST_AUTO_TEST_CASE(PairedInfoCompressedBenchmark) {
+    typedef std::chrono::steady_clock clock;
+    MockLargeGraph graph(1000000);
+    std::mt19937 rnd(42);
+    //Only every fifth edge has paired info, the rest of ids are not stored by the compressed index
+    std::uniform_int_distribution<size_t> edge(0, graph.size() / 5 - 1), shift(0, 100);
+    std::uniform_int_distribution<int> dist(-50, 500);
+
+    std::vector<std::pair<size_t, size_t>> queries;
+    for (size_t i = 0; i < 200000; ++i) {
+        size_t e1 = edge(rnd) * 5;
+        queries.emplace_back(e1, (e1 + shift(rnd)) % graph.size());
+    }
+
+    size_t allocated = utils::get_allocated_memory();
+    UnclusteredPairedInfoIndexT<MockLargeGraph> pi(graph);
+    for (const auto &q : queries) {
+        for (size_t j = 0; j < 4; ++j)
+            pi.Add(q.first, q.second, RawPoint(dist(rnd), 1));
+    }
+    size_t btree_memory = utils::get_allocated_memory() - allocated;
+
+    auto start = clock::now();
+    allocated = utils::get_allocated_memory();
+    CompressedUnclusteredPairedInfoIndexT<MockLargeGraph> cpi(graph);
+    cpi.Init(pi);
+    size_t compressed_memory = utils::get_allocated_memory() - allocated;
+    double build_time = std::chrono::duration<double>(clock::now() - start).count();
+    BOOST_CHECK_EQUAL(cpi.size(), pi.size());
+    BOOST_CHECK(cpi.memory_usage() <= compressed_memory + sizeof(cpi));
+
+    std::shuffle(queries.begin(), queries.end(), rnd);
+    start = clock::now();
+    double btree_weight = LookupWeight(pi, queries);
+    double btree_time = std::chrono::duration<double>(clock::now() - start).count();
+    start = clock::now();
+    double compressed_weight = LookupWeight(cpi, queries);
+    double compressed_time = std::chrono::duration<double>(clock::now() - start).count();
+    BOOST_CHECK_EQUAL(btree_weight, compressed_weight);
+
+    INFO("Paired info with " << pi.size() << " points: btree index " << btree_memory / 1024 << " KB allocated, "
+         << btree_time << " s per " << queries.size() << " lookups; compressed index "
+         << compressed_memory / 1024 << " KB allocated (" << cpi.memory_usage() / 1024 << " KB reported), "
+         << compressed_time << " s, built in " << build_time << " s");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -8,6 +8,10 @@
 
 #include <boost/test/unit_test.hpp>
 #include "paired_info/paired_info_helpers.hpp"
+#include "paired_info/compressed_paired_info.hpp"
+#include "paired_info/concurrent_pair_info_buffer.hpp"
+
+#include <random>
 
 namespace debruijn_graph {
 
@@ -435,6 +439,68 @@ BOOST_AUTO_TEST_CASE(PairedInfoPairTraverse) {
     BOOST_CHECK_EQUAL(GetEdgePairInfo(pi), test1);
 }
 
+using MockCompressedIndex = CompressedUnclusteredPairedInfoIndexT<MockGraph>;
+
+BOOST_AUTO_TEST_CASE(PairedInfoCompressed) {
+    MockGraph graph;
+    MockIndex pi(graph);
+    pi.Add(1, 8, {1, 3});
+    pi.Add(1, 3, {2, 2});
+    pi.Add(1, 3, {3, 1.5});
+    pi.Add(1, 1, {0, 1});
+    MockCompressedIndex cpi(graph);
+    cpi.Init(pi);
+    BOOST_CHECK_EQUAL(cpi.size(), pi.size());
+    for (MockGraph::EdgeId e1 : {1, 2, 3, 4, 5, 7, 8, 9, 13, 14}) {
+        BOOST_CHECK_EQUAL(cpi.contains(e1), pi.contains(e1));
+        BOOST_CHECK_EQUAL(GetNeighbours(cpi, e1), GetNeighbours(pi, e1));
+        for (MockGraph::EdgeId e2 : {1, 2, 3, 4, 5, 7, 8, 9, 13, 14}) {
+            BOOST_CHECK_EQUAL(cpi.contains(e1, e2), pi.contains(e1, e2));
+            BOOST_CHECK_EQUAL(cpi.Get(e1, e2).Unwrap(), pi.Get(e1, e2).Unwrap());
+            BOOST_CHECK_EQUAL(cpi.GetHalf(e1)[e2].Unwrap(), pi.GetHalf(e1)[e2].Unwrap());
+        }
+    }
+    BOOST_CHECK_EQUAL(cpi.Get(4, 2).max().weight, 1.5);
+
+    //Check merging from the concurrent buffer
+    ConcurrentPairedInfoBuffer<MockGraph> buffer(graph);
+    buffer.Add(1, 3, {2, 1});
+    buffer.Add(5, 13, {7, 1});
+    cpi.Merge(buffer);
+    pi.Merge(buffer);
+    BOOST_CHECK_EQUAL(cpi.size(), pi.size());
+    BOOST_CHECK_EQUAL(cpi.Get(1, 3).Unwrap(), pi.Get(1, 3).Unwrap());
+    BOOST_CHECK_EQUAL(cpi.Get(14, 7).Unwrap(), pi.Get(14, 7).Unwrap());
+}
+
+BOOST_AUTO_TEST_CASE(PairedInfoSharded) {
+    MockGraph graph;
+    MockIndex pi(graph);
+    const size_t threads = 3;
+    ShardedPairedInfoBuffer<MockGraph> buffer(graph, threads, 2);
+    std::vector<MockGraph::EdgeId> edges = {1, 2, 3, 4, 5, 7, 8, 9, 13, 14};
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<size_t> edge(0, edges.size() - 1), thread(0, threads - 1);
+    std::uniform_int_distribution<int> dist(-5, 20);
+    //Enough points to compact the arenas several times, including self-conjugate pairs
+    for (size_t i = 0; i < 50000; ++i) {
+        MockGraph::EdgeId e1 = edges[edge(rnd)], e2 = edges[edge(rnd)];
+        RawPoint p(dist(rnd), 1);
+        pi.Add(e1, e2, p);
+        buffer.Add(thread(rnd), e1, e2, p);
+    }
+    buffer.Finalize();
+
+    MockIndex result(graph);
+    result.MoveAssign(buffer);
+    BOOST_CHECK_EQUAL(result.size(), pi.size());
+    BOOST_CHECK_EQUAL(GetEdgePairInfo(result), GetEdgePairInfo(pi));
+    for (MockGraph::EdgeId e1 : edges) {
+        for (MockGraph::EdgeId e2 : edges)
+            BOOST_CHECK_EQUAL(result.Get(e1, e2).Unwrap(), pi.Get(e1, e2).Unwrap());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
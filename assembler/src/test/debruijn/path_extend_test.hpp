@@ -18,8 +18,11 @@
 #include <boost/test/unit_test.hpp>
 
 #include "test_utils.hpp"
+#include "simplification_test_utils.hpp"
 #include "modules/path_extend/path_visualizer.hpp"
+#include "modules/path_extend/pe_resolver.hpp"
 #include "modules/path_extend/pe_utils.hpp"
+#include "modules/path_extend/ideal_pair_info.hpp"
 namespace path_extend {
 
 BOOST_FIXTURE_TEST_SUITE(path_extend_basic, fs::TmpFolderFixture)
@@ -764,6 +767,124 @@ BOOST_AUTO_TEST_CASE( BidirectionalPathLoopDetector ) {
     BOOST_CHECK_EQUAL(path1.Back(), e7);
 }
 
+BOOST_AUTO_TEST_CASE( GraphCoverageMapOverlay ) {
+    Graph g(13);
+    graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/path_extend/distance_estimation", g);
+    EdgeId e1 = g.conjugate(*g.ConstEdgeBegin());
+    EdgeId e2 = *(g.OutgoingEdges(g.EdgeEnd(e1)).begin());
+
+    GraphCoverageMap cover_map(g);
+    BidirectionalPath path1(g, e1);
+    cover_map.Subscribe(&path1);
+
+    std::vector<EdgeId> footprint;
+    GraphCoverageMap overlay(cover_map, &footprint);
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e1), 1);
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e2), 0);
+    BOOST_CHECK_EQUAL(footprint.size(), 2);
+
+    BidirectionalPath path2(g, e1);
+    overlay.Subscribe(&path2);
+    path2.PushBack(e2);
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e1), 2);
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e2), 1);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e1), 1);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e2), 0);
+
+    path1.PushBack(e2);
+    BOOST_CHECK_EQUAL(cover_map.GetCoverage(e2), 1);
+
+    overlay.Clear();
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e1), 1);
+    BOOST_CHECK_EQUAL(overlay.GetCoverage(e2), 1);
+}
+
+BOOST_AUTO_TEST_CASE( IdealPairInfoCounterPrefixSums ) {
+    Graph g(21);
+    const int d_min = 150, d_max = 450, rs = 100, k = 21;
+    std::map<int, size_t> is_distribution;
+    std::mt19937 rand(42);
+    for (int is = 100; is < 500; is += 1 + int(rand() % 3))
+        is_distribution[is] = 1 + rand() % 1000;
+    double sum = 0.;
+    for (const auto &entry : is_distribution)
+        sum += (double) entry.second;
+
+    IdealPairInfoCounter counter(g, d_min, d_max, rs, is_distribution);
+    for (int len1 : {1, 30, 99, 100, 250, 1000})
+        for (int len2 : {1, 30, 99, 100, 250, 1000})
+            for (int dist = -1200; dist <= 1200; dist += 7) {
+                double expected = 0.;
+                for (const auto &entry : is_distribution) {
+                    int is = entry.first;
+                    if (is < d_min || is > d_max)
+                        continue;
+                    int l1 = len1, l2 = len2, d = dist, reads;
+                    if (d == 0) {
+                        reads = l1 - is + 2 * rs - 2 - k + 1;
+                    } else {
+                        if (d < 0) {
+                            std::swap(l1, l2);
+                            d = -d;
+                        }
+                        int gap = d - l1;
+                        int right = std::min(is - rs - 1, gap + l2 - 1);
+                        int left = std::max(gap + k + 1 - rs, is - rs - l1 - rs + k + 1);
+                        reads = std::max(right - left + 1, 0);
+                    }
+                    expected += (double) entry.second / sum * (double) reads;
+                }
+                BOOST_CHECK_SMALL(counter.IdealPairedInfo(size_t(len1), size_t(len2), dist) - expected, 1e-6);
+            }
+}
+
+std::vector<std::vector<size_t>> GrowSimpleSeeds(debruijn_graph::conj_graph_pack &gp, size_t batch_size) {
+    typedef std::vector<std::shared_ptr<PathExtender>> Extenders;
+    auto factory = [&gp](const GraphCoverageMap &cover_map, UsedUniqueStorage &used_storage) {
+        return Extenders{std::make_shared<SimpleExtender>(gp, cover_map, used_storage,
+                                                          std::make_shared<TrivialExtensionChooser>(gp.g),
+                                                          /*is*/300, false, false)};
+    };
+
+    PathExtendResolver resolver(gp.g);
+    auto seeds = resolver.MakeSimpleSeeds();
+    seeds.SortByLength();
+
+    ScaffoldingUniqueEdgeStorage unique_storage;
+    GraphCoverageMap cover_map(gp.g);
+    UsedUniqueStorage used_storage(unique_storage);
+    CompositeExtender extender(gp.g, cover_map, used_storage, factory(cover_map, used_storage));
+    if (batch_size)
+        extender.EnableParallelGrowth(factory, batch_size);
+    PathContainer paths = resolver.ExtendSeeds(seeds, extender);
+
+    std::vector<std::vector<size_t>> answer;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        for (const BidirectionalPath *path : {paths.Get(i), paths.GetConjugate(i)}) {
+            answer.emplace_back();
+            for (size_t j = 0; j < path->Size(); ++j)
+                answer.back().push_back(gp.g.int_id(path->At(j)));
+        }
+    }
+    return answer;
+}
+
+//Parallel growth should give the sequential result for any number of threads
+BOOST_AUTO_TEST_CASE( ParallelSeedExtension ) {
+    debruijn_graph::conj_graph_pack gp(55, "tmp", 0);
+    debruijn_graph::ConstructErroneousGraph(gp, 20000, 100);
+
+    auto sequential = GrowSimpleSeeds(gp, 0);
+    BOOST_CHECK(!sequential.empty());
+
+    int max_threads = omp_get_max_threads();
+    for (int threads : {1, 4}) {
+        omp_set_num_threads(threads);
+        for (size_t batch_size : {1, 8, 1000})
+            BOOST_CHECK(GrowSimpleSeeds(gp, batch_size) == sequential);
+    }
+    omp_set_num_threads(max_threads);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,74 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "test_utils.hpp"
+
+#include <chrono>
+#include <random>
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(sequence_mapper_benchmarks, fs::TmpFolderFixture)
+
+//Mapping throughput of BasicSequenceMapper, reads with errors are mapped to the genome graph
+BOOST_AUTO_TEST_CASE( TestSequenceMapperBenchmark ) {
+    typedef io::VectorReadStream<io::SingleRead> RawStream;
+    const size_t k = 55, read_length = 100, genome_length = 50000;
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> digit(0, 3);
+    std::uniform_int_distribution<size_t> pos(0, genome_length - read_length), error(0, 99);
+
+    std::string genome;
+    for (size_t i = 0; i < genome_length; ++i)
+        genome += nucl((char) digit(rnd));
+    std::vector<io::SingleRead> genome_reads;
+    for (size_t i = 0; i + read_length <= genome_length; i += read_length / 2)
+        genome_reads.emplace_back(std::to_string(i), genome.substr(i, read_length));
+
+    conj_graph_pack gp(k, "tmp", 0);
+    auto workdir = fs::tmp::make_temp_dir(gp.workdir, "tests");
+    io::ReadStreamList<io::SingleRead> streams(io::RCWrap<io::SingleRead>(make_shared<RawStream>(genome_reads)));
+    ConstructGraph(config::debruijn_config::construction(), workdir, streams, gp.g, gp.index);
+    gp.kmer_mapper.Attach();
+    gp.EnsureBasicMapping();
+
+    std::vector<Sequence> reads;
+    for (size_t i = 0; i < 200000; ++i) {
+        std::string read = genome.substr(pos(rnd), read_length);
+        for (auto &c : read)
+            if (error(rnd) == 0)
+                c = nucl((char) digit(rnd));
+        reads.emplace_back(read);
+    }
+
+    auto mapper = MapperInstance(gp);
+    auto start = std::chrono::steady_clock::now();
+    size_t mapped = 0;
+    std::vector<MappingPath<EdgeId>> paths;
+    for (const auto &read : reads) {
+        paths.push_back(mapper->MapSequence(read));
+        mapped += !paths.back().empty();
+    }
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    INFO("Mapped " << mapped << " of " << reads.size() << " reads in " << time << " s, "
+         << size_t(double(reads.size()) / time) << " reads per second per core");
+
+    BOOST_CHECK(mapped > reads.size() / 2);
+    for (size_t i = 0; i < reads.size(); ++i) {
+        for (size_t j = 0; j < paths[i].size(); ++j) {
+            auto p = paths[i][j];
+            BOOST_CHECK_EQUAL(reads[i].Subseq(p.second.initial_range.start_pos, p.second.initial_range.end_pos + k),
+                              gp.g.EdgeNucls(p.first).Subseq(p.second.mapped_range.start_pos, p.second.mapped_range.end_pos + k));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,76 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <boost/test/unit_test.hpp>
+#include "simplification_test_utils.hpp"
+
+#include <chrono>
+
+namespace debruijn_graph {
+
+BOOST_FIXTURE_TEST_SUITE(graph_simplification_benchmarks, fs::TmpFolderFixture)
+
+BOOST_AUTO_TEST_CASE( TipClipperAndBulgeRemoverBenchmark ) {
+    conj_graph_pack gp(55, "tmp", 0);
+    ConstructErroneousGraph(gp, 200000, 300);
+    size_t initial_size = gp.g.size();
+
+    auto start = std::chrono::steady_clock::now();
+    DefaultClipTips(gp.g);
+    double tc_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t tc_size = gp.g.size();
+
+    start = std::chrono::steady_clock::now();
+    DefaultRemoveBulges(gp.g);
+    double br_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    INFO("Graph of size " << initial_size << ": tip clipping took " << tc_time << " s (size " << tc_size
+         << "), bulge removal took " << br_time << " s (size " << gp.g.size() << ")");
+
+    BOOST_CHECK(tc_size < initial_size);
+    BOOST_CHECK(gp.g.size() <= tc_size);
+}
+
+//Parallel mode of tip clipper and ec remover should give the same result for any number of threads
+BOOST_AUTO_TEST_CASE( ParallelSimplificationScaling ) {
+    auto tc_config = standard_tc_config();
+    tc_config.parallel = true;
+    auto ec_config = standard_ec_config();
+    ec_config.parallel = true;
+    auto info = standard_simplif_relevant_info();
+    info.set_parallel_batch(1000);
+
+    std::vector<std::vector<size_t>> sizes;
+    int max_threads = omp_get_max_threads();
+    for (int threads = 1; ; threads = std::min(2 * threads, max_threads)) {
+        omp_set_num_threads(threads);
+        conj_graph_pack gp(55, "tmp", 0);
+        ConstructErroneousGraph(gp, 200000, 300);
+        sizes.push_back({gp.g.size()});
+
+        auto start = std::chrono::steady_clock::now();
+        debruijn::simplification::TipClipperInstance(gp.g, tc_config, info)->Run();
+        double tc_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sizes.back().push_back(gp.g.size());
+
+        start = std::chrono::steady_clock::now();
+        debruijn::simplification::ECRemoverInstance(gp.g, ec_config, info)->Run();
+        double ec_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sizes.back().push_back(gp.g.size());
+
+        INFO(threads << " threads: tip clipping took " << tc_time << " s, ec removal took " << ec_time << " s");
+        BOOST_CHECK(sizes.back() == sizes.front());
+        if (threads == max_threads)
+            break;
+    }
+    omp_set_num_threads(max_threads);
+    BOOST_CHECK(sizes.front()[1] < sizes.front()[0]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -8,9 +8,8 @@
 #pragma once
 
 #include <boost/test/unit_test.hpp>
-#include "test_utils.hpp"
+#include "simplification_test_utils.hpp"
 #include "modules/simplification/parallel_simplification_algorithms.hpp"
-#include "stages/simplification_pipeline/graph_simplification.hpp"
 #include "stages/simplification_pipeline/single_cell_simplification.hpp"
 #include "stages/simplification_pipeline/rna_simplification.hpp"
 #include "assembly_graph/stats/picture_dump.hpp"
@@ -21,126 +20,6 @@ using namespace config;
 
 BOOST_FIXTURE_TEST_SUITE(graph_simplification_tests, fs::TmpFolderFixture)
 
-debruijn_config::simplification::bulge_remover standard_br_config_generation() {
-    debruijn_config::simplification::bulge_remover br_config;
-    br_config.enabled = true;
-    br_config.main_iteration_only = false;
-    br_config.max_bulge_length_coefficient = 4;
-    br_config.max_additive_length_coefficient = 0;
-    br_config.max_coverage = 1000.;
-    br_config.max_relative_coverage = 1.2;
-    br_config.max_delta = 3;
-    br_config.max_number_edges = std::numeric_limits<size_t>::max();
-    br_config.dijkstra_vertex_limit = std::numeric_limits<size_t>::max();
-    br_config.max_relative_delta = 0.1;
-    //fixme test both
-    br_config.parallel = false;//true;
-    br_config.buff_size = 10000;
-    br_config.buff_cov_diff = 2.;
-    br_config.buff_cov_rel_diff = 0.2;
-    return br_config;
-}
-
-//static size_t standard_read_length() {
-//    return 100;
-//}
-
-debruijn_config::simplification::bulge_remover standard_br_config() {
-    static debruijn_config::simplification::bulge_remover br_config = standard_br_config_generation();
-    return br_config;
-}
-
-debruijn_config::simplification::erroneous_connections_remover standard_ec_config_generation() {
-    debruijn_config::simplification::erroneous_connections_remover ec_config;
-    ec_config.condition = "{ cb 30 , ec_lb 20 }";
-    return ec_config;
-}
-
-debruijn_config::simplification::erroneous_connections_remover standard_ec_config() {
-    static debruijn_config::simplification::erroneous_connections_remover ec_config = standard_ec_config_generation();
-    return ec_config;
-}
-
-debruijn_config::simplification::topology_based_ec_remover topology_based_ec_config_generation() {
-    debruijn_config::simplification::topology_based_ec_remover tec_config;
-    tec_config.max_ec_length_coefficient = 20;
-    tec_config.plausibility_length = 200;
-    tec_config.uniqueness_length = 1500;
-    return tec_config;
-}
-
-debruijn_config::simplification::max_flow_ec_remover max_flow_based_ec_config_generation() {
-    debruijn_config::simplification::max_flow_ec_remover mfec_config;
-    mfec_config.enabled = true;
-    mfec_config.max_ec_length_coefficient = 20;
-    mfec_config.plausibility_length = 200;
-    mfec_config.uniqueness_length = 3000;
-    return mfec_config;
-}
-
-debruijn_config::simplification::topology_based_ec_remover standard_tec_config() {
-    static debruijn_config::simplification::topology_based_ec_remover tec_config = topology_based_ec_config_generation();
-    return tec_config;
-}
-
-debruijn_config::simplification::max_flow_ec_remover standard_mfec_config() {
-    static debruijn_config::simplification::max_flow_ec_remover tec_config = max_flow_based_ec_config_generation();
-    return tec_config;
-}
-
-debruijn_config::simplification::tip_clipper standard_tc_config_generation() {
-    debruijn_config::simplification::tip_clipper tc_config;
-    tc_config.condition = "{ tc_lb 2.5 , cb 1000. , rctc 1.2 }";
-    return tc_config;
-}
-
-debruijn_config::simplification::tip_clipper standard_tc_config() {
-    static debruijn_config::simplification::tip_clipper tc_config = standard_tc_config_generation();
-    return tc_config;
-}
-
-debruijn_config::simplification::relative_coverage_comp_remover standard_rcc_config() {
-    debruijn_config::simplification::relative_coverage_comp_remover rcc;
-    //rather unrealistic value =)
-    rcc.enabled = true;
-    rcc.coverage_gap = 2.;
-    rcc.length_coeff = 2.;
-    rcc.tip_allowing_length_coeff = 2.;
-    rcc.max_ec_length_coefficient = 65;
-    rcc.max_coverage_coeff = 10000.;
-    rcc.vertex_count_limit = 10;
-    return rcc;
-}
-
-debruijn::simplification::SimplifInfoContainer standard_simplif_relevant_info() {
-    debruijn::simplification::SimplifInfoContainer info(config::pipeline_type::base);
-    return info.set_read_length(100)
-            .set_detected_coverage_bound(10.)
-            .set_main_iteration(true)
-            .set_chunk_cnt(1);
-}
-
-std::string graph_fragment_root() {
-    return "./src/test/debruijn/graph_fragments/";
-}
-
-void PrintGraph(const Graph & g) {
-    for (VertexId v: g) {
-        for (EdgeId e: g.OutgoingEdges(v)) {
-            cout << g.int_id(e) << ":" << g.int_id(g.EdgeStart(e)) << " " << g.int_id(g.EdgeEnd(e)) << endl;
-        }
-    }
-    cout << endl;
-}
-
-void DefaultClipTips(Graph& graph) {
-    debruijn::simplification::TipClipperInstance(graph, standard_tc_config(), standard_simplif_relevant_info())->Run();
-}
-
-void DefaultRemoveBulges(Graph& graph) {
-    debruijn::simplification::BRInstance(graph, standard_br_config(), standard_simplif_relevant_info())->Run();
-}
-
 BOOST_AUTO_TEST_CASE( SimpleTipClipperTest ) {
     ConjugateDeBruijnGraph g(55);
     graphio::ScanBasicGraph<ConjugateDeBruijnGraph>("./src/test/debruijn/graph_fragments/simpliest_tip/simpliest_tip", g);
@@ -265,6 +144,93 @@ BOOST_AUTO_TEST_CASE( MFUniquePath ) {
 //       BOOST_CHECK_EQUAL(g.size(), 4u);
 //}
 
+struct TestBucketComparator {
+    bool operator()(int a, int b) const {
+        return a / 10 == b / 10 ? a > b : a < b;
+    }
+
+    size_t bucket(int a) const {
+        return size_t(a / 10);
+    }
+};
+
+template<class Comparator>
+void CheckQueueIterator(int max_value = 1000) {
+    std::mt19937 rnd(42);
+    adt::DynamicQueueIterator<int, Comparator> it;
+    std::set<int, Comparator> reference;
+    for (size_t i = 0; i < 100000; ++i) {
+        int el = int(rnd() % max_value);
+        switch (rnd() % 4) {
+            case 0:
+                it.erase(el);
+                reference.erase(el);
+                break;
+            case 1:
+                if (!reference.empty()) {
+                    BOOST_CHECK_EQUAL(*it, *reference.begin());
+                    reference.erase(*it);
+                    ++it;
+                }
+                break;
+            default:
+                it.push(el);
+                reference.insert(el);
+        }
+        BOOST_CHECK_EQUAL(it.size(), reference.size());
+    }
+    for (; !it.IsEnd(); ++it) {
+        BOOST_CHECK_EQUAL(*it, *reference.begin());
+        reference.erase(reference.begin());
+    }
+    BOOST_CHECK(reference.empty());
+}
+
+BOOST_AUTO_TEST_CASE( QueueIteratorOrder ) {
+    CheckQueueIterator<std::less<int>>();
+    CheckQueueIterator<TestBucketComparator>();
+    //priority classes exceeding the bucket limit
+    CheckQueueIterator<TestBucketComparator>(100000);
+}
+
+//Comparator which fails on the elements removed from the "graph"
+struct TestAliveComparator {
+    std::shared_ptr<std::set<int>> alive;
+
+    bool operator()(int a, int b) const {
+        BOOST_REQUIRE(alive->count(a) && alive->count(b));
+        return a < b;
+    }
+
+    size_t bucket(int a) const {
+        BOOST_REQUIRE(alive->count(a));
+        return size_t(a / 10);
+    }
+};
+
+BOOST_AUTO_TEST_CASE( QueueIteratorErasedNotCompared ) {
+    std::mt19937 rnd(42);
+    auto alive = std::make_shared<std::set<int>>();
+    adt::DynamicQueueIterator<int, TestAliveComparator> it(TestAliveComparator{alive});
+    for (size_t i = 0; i < 100000; ++i) {
+        int el = int(rnd() % 5000);
+        if (rnd() % 3 == 0) {
+            it.erase(el);
+            alive->erase(el);
+        } else {
+            alive->insert(el);
+            it.push(el);
+        }
+    }
+    int prev = -1;
+    for (; !it.IsEnd(); ++it) {
+        BOOST_CHECK(*it > prev);
+        prev = *it;
+        alive->erase(*it);
+    }
+    BOOST_CHECK(alive->empty());
+}
+
 BOOST_AUTO_TEST_CASE( ComplexBulgeRemoverOnSimpleBulge ) {
        Graph g(55);
        graphio::ScanBasicGraph("./src/test/debruijn/graph_fragments/simpliest_bulge/simpliest_bulge", g);
@@ -389,6 +355,62 @@ BOOST_AUTO_TEST_CASE( ParallelTipClipper1 ) {
     BOOST_CHECK_EQUAL(gp.g.size(), graph_size);
 }
 
+size_t ClipTipsInBatches(conj_graph_pack &gp, size_t batch_size) {
+    debruijn::simplification::ConditionParser<Graph> parser(gp.g, standard_tc_config().condition, standard_simplif_relevant_info());
+    auto condition = parser();
+    omnigraph::ParallelEdgeRemovingAlgorithm<Graph, omnigraph::LengthComparator<Graph>> algo(gp.g,
+            omnigraph::AddTipCondition(gp.g, condition), standard_simplif_relevant_info().chunk_cnt(),
+            nullptr, /*canonical_only*/true, omnigraph::LengthComparator<Graph>(gp.g));
+    algo.EnableParallelProcessing(batch_size);
+    return algo.Run();
+}
+
+std::multiset<std::pair<std::string, unsigned>> EdgesWithCoverage(const Graph &g) {
+    std::multiset<std::pair<std::string, unsigned>> edges;
+    for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+        edges.insert({g.EdgeNucls(*it).str(), g.coverage_index().RawCoverage(*it)});
+    return edges;
+}
+
+BOOST_AUTO_TEST_CASE( BatchedTipClipper ) {
+    string path = "./src/test/debruijn/graph_fragments/tips/graph";
+    conj_graph_pack gp(55, "tmp", 0), gp_seq(55, "tmp", 0);
+    graphio::ScanGraphPack(path, gp);
+    graphio::ScanGraphPack(path, gp_seq);
+    size_t triggered = ClipTipsInBatches(gp_seq, 0);
+    BOOST_CHECK_EQUAL(ClipTipsInBatches(gp, 2), triggered);
+    BOOST_CHECK_EQUAL(gp.g.size(), 12u);
+    BOOST_CHECK(EdgesWithCoverage(gp.g) == EdgesWithCoverage(gp_seq.g));
+}
+
+BOOST_AUTO_TEST_CASE( BatchedTipClipperOnErroneousGraph ) {
+    conj_graph_pack gp_seq(55, "tmp", 0);
+    ConstructErroneousGraph(gp_seq, 20000, 300);
+    size_t initial_size = gp_seq.g.size();
+    size_t triggered = ClipTipsInBatches(gp_seq, 0);
+    BOOST_CHECK(gp_seq.g.size() < initial_size);
+
+    for (size_t batch_size : {1, 7, 1000}) {
+        conj_graph_pack gp(55, "tmp", 0);
+        ConstructErroneousGraph(gp, 20000, 300);
+        BOOST_CHECK_EQUAL(ClipTipsInBatches(gp, batch_size), triggered);
+        BOOST_CHECK(EdgesWithCoverage(gp.g) == EdgesWithCoverage(gp_seq.g));
+    }
+}
+
+//Content hash is maintained through the edge deletions, merges and gluings
+BOOST_AUTO_TEST_CASE( GraphContentHashFollowsSimplification ) {
+    conj_graph_pack gp(55, "tmp", 0);
+    ConstructErroneousGraph(gp, 20000, 300);
+    uint64_t initial_hash = gp.content_hash.hash();
+    BOOST_CHECK_EQUAL(initial_hash, omnigraph::GraphContentHash<Graph>(gp.g).hash());
+
+    ClipTipsInBatches(gp, 7);
+    DefaultRemoveBulges(gp.g);
+    BOOST_CHECK(gp.content_hash.hash() != initial_hash);
+    BOOST_CHECK_EQUAL(gp.content_hash.hash(), omnigraph::GraphContentHash<Graph>(gp.g).hash());
+}
+
 BOOST_AUTO_TEST_CASE( ParallelECRemover ) {
     string path = graph_fragment_root() + "complex_bulge/complex_bulge";
     conj_graph_pack gp(55, "tmp", 0);
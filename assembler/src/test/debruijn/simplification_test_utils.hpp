@@ -0,0 +1,162 @@
+//***************************************************************************
+//* Copyright (c) 2018 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "test_utils.hpp"
+#include "stages/simplification_pipeline/graph_simplification.hpp"
+
+#include <random>
+
+namespace debruijn_graph {
+using namespace config;
+
+debruijn_config::simplification::bulge_remover standard_br_config_generation() {
+    debruijn_config::simplification::bulge_remover br_config;
+    br_config.enabled = true;
+    br_config.main_iteration_only = false;
+    br_config.max_bulge_length_coefficient = 4;
+    br_config.max_additive_length_coefficient = 0;
+    br_config.max_coverage = 1000.;
+    br_config.max_relative_coverage = 1.2;
+    br_config.max_delta = 3;
+    br_config.max_number_edges = std::numeric_limits<size_t>::max();
+    br_config.dijkstra_vertex_limit = std::numeric_limits<size_t>::max();
+    br_config.max_relative_delta = 0.1;
+    //fixme test both
+    br_config.parallel = false;//true;
+    br_config.buff_size = 10000;
+    br_config.buff_cov_diff = 2.;
+    br_config.buff_cov_rel_diff = 0.2;
+    return br_config;
+}
+
+//static size_t standard_read_length() {
+//    return 100;
+//}
+
+debruijn_config::simplification::bulge_remover standard_br_config() {
+    static debruijn_config::simplification::bulge_remover br_config = standard_br_config_generation();
+    return br_config;
+}
+
+debruijn_config::simplification::erroneous_connections_remover standard_ec_config_generation() {
+    debruijn_config::simplification::erroneous_connections_remover ec_config;
+    ec_config.condition = "{ cb 30 , ec_lb 20 }";
+    return ec_config;
+}
+
+debruijn_config::simplification::erroneous_connections_remover standard_ec_config() {
+    static debruijn_config::simplification::erroneous_connections_remover ec_config = standard_ec_config_generation();
+    return ec_config;
+}
+
+debruijn_config::simplification::topology_based_ec_remover topology_based_ec_config_generation() {
+    debruijn_config::simplification::topology_based_ec_remover tec_config;
+    tec_config.max_ec_length_coefficient = 20;
+    tec_config.plausibility_length = 200;
+    tec_config.uniqueness_length = 1500;
+    return tec_config;
+}
+
+debruijn_config::simplification::max_flow_ec_remover max_flow_based_ec_config_generation() {
+    debruijn_config::simplification::max_flow_ec_remover mfec_config;
+    mfec_config.enabled = true;
+    mfec_config.max_ec_length_coefficient = 20;
+    mfec_config.plausibility_length = 200;
+    mfec_config.uniqueness_length = 3000;
+    return mfec_config;
+}
+
+debruijn_config::simplification::topology_based_ec_remover standard_tec_config() {
+    static debruijn_config::simplification::topology_based_ec_remover tec_config = topology_based_ec_config_generation();
+    return tec_config;
+}
+
+debruijn_config::simplification::max_flow_ec_remover standard_mfec_config() {
+    static debruijn_config::simplification::max_flow_ec_remover tec_config = max_flow_based_ec_config_generation();
+    return tec_config;
+}
+
+debruijn_config::simplification::tip_clipper standard_tc_config_generation() {
+    debruijn_config::simplification::tip_clipper tc_config;
+    tc_config.condition = "{ tc_lb 2.5 , cb 1000. , rctc 1.2 }";
+    return tc_config;
+}
+
+debruijn_config::simplification::tip_clipper standard_tc_config() {
+    static debruijn_config::simplification::tip_clipper tc_config = standard_tc_config_generation();
+    return tc_config;
+}
+
+debruijn_config::simplification::relative_coverage_comp_remover standard_rcc_config() {
+    debruijn_config::simplification::relative_coverage_comp_remover rcc;
+    //rather unrealistic value =)
+    rcc.enabled = true;
+    rcc.coverage_gap = 2.;
+    rcc.length_coeff = 2.;
+    rcc.tip_allowing_length_coeff = 2.;
+    rcc.max_ec_length_coefficient = 65;
+    rcc.max_coverage_coeff = 10000.;
+    rcc.vertex_count_limit = 10;
+    return rcc;
+}
+
+debruijn::simplification::SimplifInfoContainer standard_simplif_relevant_info() {
+    debruijn::simplification::SimplifInfoContainer info(config::pipeline_type::base);
+    return info.set_read_length(100)
+            .set_detected_coverage_bound(10.)
+            .set_main_iteration(true)
+            .set_chunk_cnt(1);
+}
+
+std::string graph_fragment_root() {
+    return "./src/test/debruijn/graph_fragments/";
+}
+
+void PrintGraph(const Graph & g) {
+    for (VertexId v: g) {
+        for (EdgeId e: g.OutgoingEdges(v)) {
+            cout << g.int_id(e) << ":" << g.int_id(g.EdgeStart(e)) << " " << g.int_id(g.EdgeEnd(e)) << endl;
+        }
+    }
+    cout << endl;
+}
+
+void DefaultClipTips(Graph& graph) {
+    debruijn::simplification::TipClipperInstance(graph, standard_tc_config(), standard_simplif_relevant_info())->Run();
+}
+
+void DefaultRemoveBulges(Graph& graph) {
+    debruijn::simplification::BRInstance(graph, standard_br_config(), standard_simplif_relevant_info())->Run();
+}
+
+//Graph of the random genome built from the reads with errors (so it has tips and bulges)
+void ConstructErroneousGraph(conj_graph_pack &gp, size_t genome_length, size_t error_rate) {
+    typedef io::VectorReadStream<io::SingleRead> RawStream;
+    const size_t read_length = 100;
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> digit(0, 3);
+    std::uniform_int_distribution<size_t> pos(0, genome_length - read_length), error(0, error_rate - 1);
+
+    std::string genome;
+    for (size_t i = 0; i < genome_length; ++i)
+        genome += nucl((char) digit(rnd));
+    std::vector<io::SingleRead> reads;
+    for (size_t i = 0; i < 4 * genome_length / read_length; ++i) {
+        std::string read = genome.substr(pos(rnd), read_length);
+        for (auto &c : read)
+            if (error(rnd) == 0)
+                c = nucl((char) digit(rnd));
+        reads.emplace_back(std::to_string(i), read);
+    }
+
+    auto workdir = fs::tmp::make_temp_dir(gp.workdir, "tests");
+    io::ReadStreamList<io::SingleRead> streams(io::RCWrap<io::SingleRead>(make_shared<RawStream>(reads)));
+    ConstructGraph(config::debruijn_config::construction(), workdir, streams, gp.g, gp.index);
+}
+
+}
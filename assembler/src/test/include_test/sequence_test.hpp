@@ -70,6 +70,26 @@ BOOST_AUTO_TEST_CASE( TestSequenceRefCount2 ) {
     delete ss;
 }
 
+BOOST_AUTO_TEST_CASE( TestSequencePack ) {
+    std::vector<Sequence> seqs = { Sequence("ACGTACGTACGTACGTACGTACGTACGTACGTACG"),
+                                   !Sequence("TTGCA"),
+                                   Sequence("ACGTTGCA").Subseq(3),
+                                   Sequence("C") };
+    std::vector<std::string> strs;
+    for (const auto &s : seqs)
+        strs.push_back(s.str());
+
+    Sequence::Pack(seqs, 16);
+    for (size_t i = 0; i < seqs.size(); ++i)
+        BOOST_CHECK_EQUAL(strs[i], seqs[i].str());
+
+    // First sequence exceeds the arena size and goes alone, the rest are packed together
+    BOOST_CHECK(seqs[0].buffer_id() != seqs[1].buffer_id());
+    BOOST_CHECK_EQUAL(seqs[1].buffer_id(), seqs[3].buffer_id());
+    BOOST_CHECK_EQUAL(size_t(11), seqs[1].buffer_capacity());
+    BOOST_CHECK_EQUAL(strs[1], (!!seqs[1]).str());
+}
+
 //todo is it suitable here???
 //BOOST_AUTO_TEST_CASE( TestSequenceMemory ) {
 //    time_t now = time(NULL);